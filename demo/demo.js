@@ -15,6 +15,16 @@ const neighborSlider = document.getElementById("neighbor");
 const applypp = document.getElementById("applypp");
 let pp = 1;
 
+const intervalOutput = document.getElementById("interval-output");
+const intervalSlider = document.getElementById("interval");
+const applyTracking = document.getElementById("applytracking");
+let tracking = 1;
+
+const uploadOutput = document.getElementById("upload-output");
+const detectOutput = document.getElementById("detect-output");
+const readOutput = document.getElementById("read-output");
+const timing = {upload: 0, detect: 0, read: 0, frames: 0};
+
 const outputOverlayCtx = outputOverlayCanvas.getContext("2d");
 const inputCtx = inputCanvas.getContext("2d");
 
@@ -33,22 +43,55 @@ deltaSlider.oninput = () => deltaOutput.innerHTML = deltaSlider.value;
 overlapSlider.oninput = () => overlapOutput.innerHTML = overlapSlider.value;
 neighborSlider.oninput = () => neighborOutput.innerHTML = neighborSlider.value;
 applypp.onchange = () => pp = applypp.checked ? 1 : 0;
+intervalSlider.oninput = () => intervalOutput.innerHTML = intervalSlider.value;
+applyTracking.onchange = () => tracking = applyTracking.checked ? 1 : 0;
+
+// The release build in dist predates tracking, views and timing, so when the demo is served from there it detects every
+// frame in full with detect, and times the whole call itself
+if (typeof Wasmface.prototype.track !== "function") {
+	applyTracking.checked = false;
+	applyTracking.disabled = true;
+	tracking = 0;
+}
+const hasViews = typeof Wasmface.prototype.detectView === "function";
 
 function start() {
 	if (!myWasmface) myWasmface = new Wasmface(humanFace);
 	if (!loopId) loopId = window.requestAnimationFrame(update);
 		
 	function update() {
+		let elapsed = 0;
 		inputCtx.drawImage(video, 0, 0, video.videoWidth, video.videoHeight);
 		outputOverlayCtx.clearRect(0, 0, outputOverlayCanvas.width, outputOverlayCanvas.height);
-		const boxes = myWasmface.detect(inputCtx, pp, overlapSlider.value, neighborSlider.value, stepSlider.value, deltaSlider.value);
-		
-		for (let i = 0, len = boxes.length; i < len; i += 1) {
-			outputOverlayCtx.strokeStyle = "#77ff33";
-			outputOverlayCtx.lineWidth = 4;
-			outputOverlayCtx.beginPath();
-			outputOverlayCtx.rect(boxes[i][0], boxes[i][1], boxes[i][2], boxes[i][2]); 
-			outputOverlayCtx.stroke();
+		outputOverlayCtx.strokeStyle = "#77ff33";
+		outputOverlayCtx.lineWidth = 4;
+		outputOverlayCtx.beginPath();
+		if (tracking) {
+			const boxes = myWasmface.track(inputCtx, Number(intervalSlider.value), pp, overlapSlider.value, neighborSlider.value, stepSlider.value, deltaSlider.value);
+			for (let i = 0, len = boxes.length; i < len; i += 1) outputOverlayCtx.rect(boxes[i][0], boxes[i][1], boxes[i][2], boxes[i][2]);
+		} else if (hasViews) {
+			const records = myWasmface.detectView(inputCtx, 0, pp, overlapSlider.value, neighborSlider.value, stepSlider.value, deltaSlider.value);
+			for (let i = 0, len = records.length; i < len; i += 7) outputOverlayCtx.rect(records[i], records[i + 1], records[i + 2], records[i + 2]);
+		} else {
+			const start = performance.now();
+			const boxes = myWasmface.detect(inputCtx, pp, overlapSlider.value, neighborSlider.value, stepSlider.value, deltaSlider.value);
+			elapsed = performance.now() - start;
+			for (let i = 0, len = boxes.length; i < len; i += 1) outputOverlayCtx.rect(boxes[i][0], boxes[i][1], boxes[i][2], boxes[i][2]);
+		}
+		outputOverlayCtx.stroke();
+
+		// Average the per-frame cost of getting pixels in and results out of the wasm heap over 60 frames. Without the
+		// wrapper's timing, only the whole call is known, and it's shown as detection
+		const cost = myWasmface.timing || {upload: NaN, detect: elapsed, read: NaN};
+		timing.upload += cost.upload;
+		timing.detect += cost.detect;
+		timing.read += cost.read;
+		timing.frames += 1;
+		if (timing.frames === 60) {
+			uploadOutput.innerHTML = isNaN(timing.upload) ? "–" : (timing.upload / timing.frames).toFixed(2);
+			detectOutput.innerHTML = (timing.detect / timing.frames).toFixed(2);
+			readOutput.innerHTML = isNaN(timing.read) ? "–" : (timing.read / timing.frames).toFixed(2);
+			timing.upload = timing.detect = timing.read = timing.frames = 0;
 		}
 
 		loopId = window.requestAnimationFrame(update);
@@ -0,0 +1,129 @@
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#include "alloc-counter.h"
+
+// Heap allocations and bytes attributed to each phase, counted only in builds with WASMFACE_COUNT_ALLOCS defined.
+// The phase is per thread, since detectors on different threads are in different phases at once. The counts are shared,
+// so they are atomic, but relaxed, since nothing is ordered by them
+static thread_local int allocPhase = ALLOC_OTHER;
+static std::atomic<int> allocCounts[ALLOC_PHASES] = {};
+static std::atomic<long long> allocBytes[ALLOC_PHASES] = {};
+
+#ifdef WASMFACE_COUNT_ALLOCS
+/**
+ * Allocate from the heap and attribute the allocation to the current phase
+ * Every operator new and new[] in the program is routed here
+ * @param  {Size} size Number of bytes to allocate
+ * @return {Void*}     Pointer to the allocation
+ */
+static void* countedNew(std::size_t size) {
+	allocCounts[allocPhase].fetch_add(1, std::memory_order_relaxed);
+	allocBytes[allocPhase].fetch_add(size, std::memory_order_relaxed);
+	void* ptr = std::malloc(size ? size : 1);
+	if (!ptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new(std::size_t size) {
+	return countedNew(size);
+}
+
+void* operator new[](std::size_t size) {
+	return countedNew(size);
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+#endif
+
+/**
+ * Constructor
+ * Attributes heap allocations to a phase for as long as the scope lives, then restores the enclosing phase
+ * @param {Int} phase The phase, one of AllocPhase
+ */
+AllocScope::AllocScope(int phase) {
+	this->previous = allocPhase;
+	allocPhase = phase;
+}
+
+/**
+ * Destructor
+ */
+AllocScope::~AllocScope() {
+	allocPhase = this->previous;
+}
+
+/**
+ * Check whether this build counts heap allocations
+ * @return {Bool} True if built with WASMFACE_COUNT_ALLOCS defined
+ */
+bool countingAllocs() {
+#ifdef WASMFACE_COUNT_ALLOCS
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Zero the allocation counts of every phase
+ */
+void resetAllocCounters() {
+	for (int i = 0; i < ALLOC_PHASES; i += 1) {
+		allocCounts[i].store(0, std::memory_order_relaxed);
+		allocBytes[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * Get the number of heap allocations made during a phase since the counters were last reset
+ * @param  {Int} phase The phase, one of AllocPhase
+ * @return {Int}       Allocation count
+ */
+int countedAllocs(int phase) {
+	return phase >= 0 && phase < ALLOC_PHASES ? allocCounts[phase].load(std::memory_order_relaxed) : 0;
+}
+
+/**
+ * Get the number of bytes allocated from the heap during a phase since the counters were last reset
+ * @param  {Int}       phase The phase, one of AllocPhase
+ * @return {Long long}       Allocated bytes
+ */
+long long countedBytes(int phase) {
+	return phase >= 0 && phase < ALLOC_PHASES ? allocBytes[phase].load(std::memory_order_relaxed) : 0;
+}
+
+/**
+ * Get the number of heap allocations made during every phase since the counters were last reset
+ * @return {Int} Allocation count
+ */
+int countedAllocsTotal() {
+	int total = 0;
+	for (int i = 0; i < ALLOC_PHASES; i += 1) total += allocCounts[i].load(std::memory_order_relaxed);
+	return total;
+}
+
+/**
+ * Get the number of bytes allocated from the heap during every phase since the counters were last reset
+ * @return {Long long} Allocated bytes
+ */
+long long countedBytesTotal() {
+	long long total = 0;
+	for (int i = 0; i < ALLOC_PHASES; i += 1) total += allocBytes[i].load(std::memory_order_relaxed);
+	return total;
+}
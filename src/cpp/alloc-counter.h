@@ -0,0 +1,25 @@
+#pragma once
+
+enum AllocPhase {
+	ALLOC_OTHER,
+	ALLOC_GRAYSCALE,
+	ALLOC_INTEGRAL,
+	ALLOC_SWEEP,
+	ALLOC_POSTPROCESS,
+	ALLOC_OUTPUT,
+	ALLOC_PHASES
+};
+
+class AllocScope {
+	public:
+		AllocScope(int phase);
+		~AllocScope();
+		int previous;
+};
+
+bool countingAllocs();
+void resetAllocCounters();
+int countedAllocs(int phase);
+long long countedBytes(int phase);
+int countedAllocsTotal();
+long long countedBytesTotal();
@@ -0,0 +1,128 @@
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <chrono>
+
+#include "anytime-detector.h"
+#include "cascade-classifier.h"
+#include "integral-image.h"
+#include "window-stats.h"
+#include "sweep.h"
+#include "utility.h"
+
+/**
+ * Constructor
+ * @param {CascadeClassifier} cc    The cascade classifier to detect with
+ * @param {Int}               w     Width of the frames to be processed
+ * @param {Int}               h     Height of the frames to be processed
+ * @param {Float}             step  Detector scale step to apply
+ * @param {Float}             delta Detector sweep delta to apply
+ */
+AnytimeDetector::AnytimeDetector(CascadeClassifier& cc, int w, int h, float step, float delta) {
+	this->w = w;
+	this->h = h;
+	this->stride = std::max(1, int(step * delta));
+	this->step = step;
+	this->source = &cc;
+	this->revision = cc.revision;
+	this->scales = cc.pyramid(step, w, h);
+	this->likelihood.resize(this->scales.size(), 0);
+	this->cursor = 0;
+	this->row = 0;
+	this->coverage = {};
+	this->gray.resize(w * h * 4);
+	for (int i = 0; i < this->scales.size(); i += 1) {
+		int s = this->scales[i].baseResolution;
+		int cols = (w - s + this->stride - 1) / this->stride;
+		int rows = (h - s + this->stride - 1) / this->stride;
+		this->coverage.totalWindows += cols * rows;
+	}
+	this->prioritize();
+}
+
+/**
+ * Order the scales for the next full scan
+ * Scales that recently produced detections go first, and ties go to larger (cheaper) scales. The tie break makes the
+ * order total, so an unstable sort gives the same order without the temporary buffer a stable sort allocates
+ */
+void AnytimeDetector::prioritize() {
+	this->order.resize(this->scales.size());
+	for (int i = 0; i < this->order.size(); i += 1) this->order[i] = i;
+	std::sort(this->order.begin(), this->order.end(), [this](int a, int b) {
+		if (this->likelihood[a] != this->likelihood[b]) return this->likelihood[a] > this->likelihood[b];
+		return a > b;
+	});
+}
+
+/**
+ * Detect objects in an HTML5 ImageData buffer within a time budget
+ * Regions around the previous frame's detections are swept first, then the full scan resumes where the
+ * previous frame left off, one row at a time, until the budget runs out. The grayscale and integral image buffers
+ * are kept from frame to frame
+ * @param  {Unsigned char*}                  inputBuf Pointer to an HTML5 ImageData buffer
+ * @param  {Float}                           budget   Time budget in milliseconds
+ * @param  {Float}                           minsd    Minimum subwindow standard deviation (0 disables)
+ * @return {std::vector<std::array<int, 3>>}          Bounding boxes of the detections found in this frame, valid until the next call
+ */
+std::vector<std::array<int, 3>>& AnytimeDetector::detect(unsigned char inputBuf[], float budget, float minsd) {
+	auto start = std::chrono::steady_clock::now();
+	auto elapsed = [start]() {
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	// Stages added to the cascade don't change its scales, so the scan carries on where it was
+	if (this->source->revision != this->revision) {
+		this->scales = this->source->pyramid(this->step, this->w, this->h);
+		this->revision = this->source->revision;
+	}
+
+	toGrayscaleFloat(inputBuf, this->w, this->h, this->gray.data());
+	this->integral.compute(this->gray.data(), this->w, this->h, false, this->sumTable);
+	this->integralSquared.compute(this->gray.data(), this->w, this->h, true, this->sumTable);
+	IntegralImage& integral = this->integral;
+	IntegralImage& integralSquared = this->integralSquared;
+	WindowStats& stats = this->stats;
+	std::vector<std::array<int, 3>>& roi = this->roi;
+	roi.clear();
+	this->coverage.windows = 0;
+	this->coverage.roiWindows = 0;
+	this->coverage.scalesCompleted = 0;
+
+	// Objects move little between frames, so search the neighborhood of each previous detection first
+	for (int i = 0; i < this->previous.size() && elapsed() < budget; i += 1) {
+		this->coverage.roiWindows += sweepNeighborhood(integral, integralSquared, stats, this->scales, this->previous[i], 
+		                                               this->w, this->h, this->stride, minsd, roi);
+	}
+
+	// Resume the full scan, stopping when the budget runs out or every scale has been covered once this frame
+	while (!this->order.empty() && elapsed() < budget && this->coverage.windows < this->coverage.totalWindows) {
+		int idx = this->order[this->cursor];
+		int s = this->scales[idx].baseResolution;
+		if (this->row >= this->h - s) {
+			this->row = 0;
+			this->cursor += 1;
+			this->coverage.scalesCompleted += 1;
+			if (this->cursor == this->order.size()) {
+				this->cursor = 0;
+				this->coverage.cycles += 1;
+				this->prioritize();
+			}
+			continue;
+		}
+		sweep(integral, integralSquared, stats, this->scales[idx], 0, this->row, this->w - s, this->row + 1, this->stride, minsd, roi);
+		this->coverage.windows += stats.pass.size();
+		this->row += this->stride;
+	}
+
+	// A subwindow may have been swept both as part of a region and as part of the full scan
+	std::sort(roi.begin(), roi.end());
+	roi.erase(std::unique(roi.begin(), roi.end()), roi.end());
+
+	for (int i = 0; i < this->likelihood.size(); i += 1) this->likelihood[i] *= 0.9f;
+	for (int i = 0; i < roi.size(); i += 1) this->likelihood[nearestScale(this->scales, roi[i][2])] += 1;
+
+	this->coverage.scale = this->order.empty() ? 0 : this->order[this->cursor];
+	this->coverage.row = this->row;
+	this->coverage.elapsed = elapsed();
+	return roi;
+}
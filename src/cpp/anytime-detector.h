@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <array>
+
+#include "cascade-classifier.h"
+#include "integral-image.h"
+#include "window-stats.h"
+#include "post-processor.h"
+
+struct Coverage {
+	int windows;
+	int totalWindows;
+	int roiWindows;
+	int scalesCompleted;
+	int scale;
+	int row;
+	int cycles;
+	float elapsed;
+};
+
+class AnytimeDetector {
+	public:
+		AnytimeDetector(CascadeClassifier& cc, int w, int h, float step, float delta);
+		std::vector<std::array<int, 3>>& detect(unsigned char inputBuf[], float budget, float minsd);
+		void prioritize();
+		int w;
+		int h;
+		int stride;
+		float step;
+		int revision;
+		CascadeClassifier* source;
+		std::vector<CascadeClassifier> scales;
+		std::vector<float> likelihood;
+		std::vector<int> order;
+		int cursor;
+		int row;
+		std::vector<std::array<int, 3>> previous;
+		Coverage coverage;
+		std::vector<float> gray;
+		std::vector<float> sumTable;
+		IntegralImage integral;
+		IntegralImage integralSquared;
+		WindowStats stats;
+		std::vector<std::array<int, 3>> roi;
+		PostProcessor post;
+};
@@ -0,0 +1,159 @@
+#include <vector>
+#include <algorithm>
+#include <atomic>
+
+#include "batch-detector.h"
+#include "cascade-classifier.h"
+#include "sweep.h"
+#include "detector.h"
+
+/**
+ * Constructor
+ * A batch detector processes many images of any size per call, like a folder of thumbnails. Each worker owns one
+ * detector whose buffers grow to fit the largest image it has seen, and per image results are kept from call to
+ * call, so after the first batch the cascade is never copied and buffers are only allocated for larger images.
+ * The calling thread is the first worker and the others are started here and wait for batches, so no thread is
+ * created per call. In emscripten builds a new thread only starts once the browser event loop runs unless
+ * PTHREAD_POOL_SIZE has one ready, and the calling thread detects on its own in the meantime
+ * @param {CascadeClassifier} cc      The cascade classifier to detect with
+ * @param {Float}             step    Detector scale step to apply
+ * @param {Float}             delta   Detector sweep delta to apply
+ * @param {Int}               threads Number of worker threads, forced to 1 in builds without thread support
+ */
+BatchDetector::BatchDetector(CascadeClassifier& cc, float step, float delta, int threads) {
+#ifndef WASMFACE_THREADS
+	threads = 1;
+#endif
+	this->windowCount = 0;
+	this->rejectedCount = 0;
+	this->next = 0;
+	for (int i = 0; i < std::max(1, threads); i += 1) this->workers.push_back(new Detector(cc, 0, 0, step, delta));
+	this->windowCounts.resize(this->workers.size());
+	this->rejectedCounts.resize(this->workers.size());
+#ifdef WASMFACE_THREADS
+	this->images = nullptr;
+	this->count = 0;
+	this->stopping = false;
+	this->open = false;
+	this->batch = 0;
+	this->active = 0;
+	for (int i = 1; i < this->workers.size(); i += 1) this->pool.emplace_back(&BatchDetector::serve, this, i);
+#endif
+}
+
+/**
+ * Destructor
+ */
+BatchDetector::~BatchDetector() {
+#ifdef WASMFACE_THREADS
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->stopping = true;
+	}
+	this->ready.notify_all();
+	for (int i = 0; i < this->pool.size(); i += 1) this->pool[i].join();
+#endif
+	for (int i = 0; i < this->workers.size(); i += 1) delete this->workers[i];
+}
+
+/**
+ * Take images from the batch one at a time and detect objects in them until none are left
+ * @param {Int}              worker   Index of the worker whose detector to use
+ * @param {ImageDescriptor*} images   The batch of images
+ * @param {Int}              count    Number of images in the batch
+ * @param {Int}              pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param {Float}            othresh  Overlap threshold for post processing
+ * @param {Int}              nthresh  Neighbor threshold for post processing
+ * @param {Float}            minsd    Minimum subwindow standard deviation (0 disables)
+ * @param {Int}              mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ */
+void BatchDetector::work(int worker, ImageDescriptor images[], int count, int pp, float othresh, int nthresh, 
+                         float minsd, int mindepth) {
+	Detector* dt = this->workers[worker];
+	for (int i = this->next++; i < count; i = this->next++) {
+		if (images[i].w != dt->w || images[i].h != dt->h) dt->resize(images[i].w, images[i].h);
+		this->results[i] = dt->detect(images[i].data, pp, othresh, nthresh, minsd, mindepth);
+		this->windowCounts[worker] += dt->windowCount;
+		this->rejectedCounts[worker] += dt->rejectedCount;
+	}
+}
+
+/**
+ * Detect objects in every image of a batch
+ * Images are handed out to the workers one at a time, so a worker that draws small images takes more of them
+ * @param  {ImageDescriptor*}                    images   The batch of images, each an HTML5 ImageData buffer and its size
+ * @param  {Int}                                 count    Number of images in the batch
+ * @param  {Int}                                 pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}                               othresh  Overlap threshold for post processing
+ * @param  {Int}                                 nthresh  Neighbor threshold for post processing
+ * @param  {Float}                               minsd    Minimum subwindow standard deviation (0 disables)
+ * @param  {Int}                                 mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @return {std::vector<std::vector<Detection>>}          The post processed detections of each image, valid until the next call
+ */
+std::vector<std::vector<Detection>>& BatchDetector::detect(ImageDescriptor images[], int count, int pp, float othresh, 
+                                                           int nthresh, float minsd, int mindepth) {
+	if (this->results.size() < count) this->results.resize(count);
+	std::fill(this->windowCounts.begin(), this->windowCounts.end(), 0);
+	std::fill(this->rejectedCounts.begin(), this->rejectedCounts.end(), 0);
+	this->next = 0;
+
+#ifdef WASMFACE_THREADS
+	// Open the batch to the waiting workers. The calling thread is the first worker
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->images = images;
+		this->count = count;
+		this->pp = pp;
+		this->othresh = othresh;
+		this->nthresh = nthresh;
+		this->minsd = minsd;
+		this->mindepth = mindepth;
+		this->batch += 1;
+		this->open = count > 1;
+	}
+	if (count > 1) this->ready.notify_all();
+	this->work(0, images, count, pp, othresh, nthresh, minsd, mindepth);
+
+	// Every image has been taken, so close the batch to workers that haven't woken yet and wait for those that did
+	{
+		std::unique_lock<std::mutex> guard(this->lock);
+		this->open = false;
+		this->done.wait(guard, [this] { return this->active == 0; });
+	}
+#else
+	this->work(0, images, count, pp, othresh, nthresh, minsd, mindepth);
+#endif
+
+	this->windowCount = 0;
+	this->rejectedCount = 0;
+	for (int i = 0; i < this->workers.size(); i += 1) {
+		this->windowCount += this->windowCounts[i];
+		this->rejectedCount += this->rejectedCounts[i];
+	}
+	return this->results;
+}
+
+#ifdef WASMFACE_THREADS
+/**
+ * Worker thread loop
+ * Joins each batch that is still open when the worker wakes, and sits out any it wakes too late for
+ * @param {Int} worker Index of the worker whose detector to use
+ */
+void BatchDetector::serve(int worker) {
+	std::unique_lock<std::mutex> guard(this->lock);
+	int seen = this->batch;
+	while (true) {
+		this->ready.wait(guard, [&] { return this->stopping || (this->open && this->batch != seen); });
+		if (this->stopping) return;
+		seen = this->batch;
+		this->active += 1;
+		guard.unlock();
+
+		this->work(worker, this->images, this->count, this->pp, this->othresh, this->nthresh, this->minsd, this->mindepth);
+
+		guard.lock();
+		this->active -= 1;
+		if (this->active == 0) this->done.notify_one();
+	}
+}
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+
+#include "cascade-classifier.h"
+#include "sweep.h"
+#include "detector.h"
+#include "worker-threads.h"
+
+struct ImageDescriptor {
+	unsigned char* data;
+	int w;
+	int h;
+};
+
+class BatchDetector {
+	public:
+		BatchDetector(CascadeClassifier& cc, float step, float delta, int threads);
+		~BatchDetector();
+		std::vector<std::vector<Detection>>& detect(ImageDescriptor images[], int count, int pp, float othresh, int nthresh, 
+		                                            float minsd, int mindepth);
+		void work(int worker, ImageDescriptor images[], int count, int pp, float othresh, int nthresh, float minsd, int mindepth);
+#ifdef WASMFACE_THREADS
+		void serve(int worker);
+#endif
+		int windowCount;
+		int rejectedCount;
+		std::atomic<int> next;
+		std::vector<int> windowCounts;
+		std::vector<int> rejectedCounts;
+		std::vector<Detector*> workers;
+		std::vector<std::vector<Detection>> results;
+#ifdef WASMFACE_THREADS
+		ImageDescriptor* images;
+		int count;
+		int pp;
+		float othresh;
+		int nthresh;
+		float minsd;
+		int mindepth;
+		bool stopping;
+		bool open;
+		int batch;
+		int active;
+		std::vector<std::thread> pool;
+		std::mutex lock;
+		std::condition_variable ready;
+		std::condition_variable done;
+#endif
+};
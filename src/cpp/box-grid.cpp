@@ -0,0 +1,106 @@
+#include <vector>
+#include <array>
+#include <algorithm>
+
+#include "box-grid.h"
+
+/**
+ * Constructor
+ * Makes an empty grid, to be filled by build
+ */
+BoxGrid::BoxGrid() {
+	this->cell = 1;
+	this->cols = 0;
+	this->rows = 0;
+	this->minX = 0;
+	this->minY = 0;
+}
+
+/**
+ * Constructor
+ * @param {std::vector<std::array<int, 3>>} boxes  The set of bounding boxes [x, y, s], must not be empty
+ * @param {Bool}                            single True puts every box in a single cell
+ */
+BoxGrid::BoxGrid(std::vector<std::array<int, 3>>& boxes, bool single) {
+	this->build(boxes, single);
+}
+
+/**
+ * Bucket a set of 1:1 aspect ratio bounding boxes by upper left corner on a grid of cells as large as the
+ * largest box. Any box that intersects a given box then has its upper left corner in the same cell as that
+ * box's upper left corner or in one of the eight around it
+ * Bucket b holds the indices bucket[start[b]] to bucket[start[b] + count[b] - 1]
+ * Rebuilding a grid reuses its storage, so it only allocates when given more boxes or cells than ever before
+ * @param {std::vector<std::array<int, 3>>} boxes  The set of bounding boxes [x, y, s], must not be empty
+ * @param {Bool}                            single True puts every box in a single cell
+ */
+void BoxGrid::build(std::vector<std::array<int, 3>>& boxes, bool single) {
+	int len = boxes.size();
+	int maxX = boxes[0][0];
+	int maxY = boxes[0][1];
+	this->minX = boxes[0][0];
+	this->minY = boxes[0][1];
+	this->cell = 1;
+	for (int i = 0; i < len; i += 1) {
+		this->minX = std::min(this->minX, boxes[i][0]);
+		this->minY = std::min(this->minY, boxes[i][1]);
+		maxX = std::max(maxX, boxes[i][0]);
+		maxY = std::max(maxY, boxes[i][1]);
+		this->cell = std::max(this->cell, boxes[i][2]);
+	}
+	if (single) this->cell = std::max(this->cell, std::max(maxX - this->minX, maxY - this->minY) + 1);
+
+	// Counting sort
+	this->cols = (maxX - this->minX) / this->cell + 1;
+	this->rows = (maxY - this->minY) / this->cell + 1;
+	this->bucketOf.resize(len);
+	this->start.assign(this->cols * this->rows + 1, 0);
+	for (int i = 0; i < len; i += 1) {
+		this->bucketOf[i] = this->row(boxes[i][1]) * this->cols + this->col(boxes[i][0]);
+		this->start[this->bucketOf[i] + 1] += 1;
+	}
+	for (int i = 0; i < this->cols * this->rows; i += 1) this->start[i + 1] += this->start[i];
+	this->count.assign(this->cols * this->rows, 0);
+	this->bucket.resize(len);
+	for (int i = 0; i < len; i += 1) {
+		int b = this->bucketOf[i];
+		this->bucket[this->start[b] + this->count[b]] = i;
+		this->count[b] += 1;
+	}
+}
+
+/**
+ * Get the grid column containing an x offset, which is negative left of the grid
+ * @param  {Int} x X offset
+ * @return {Int}   Column
+ */
+int BoxGrid::col(int x) {
+	int dx = x - this->minX;
+	return dx >= 0 ? dx / this->cell : -((this->cell - 1 - dx) / this->cell);
+}
+
+/**
+ * Get the grid row containing a y offset, which is negative above the grid
+ * @param  {Int} y Y offset
+ * @return {Int}   Row
+ */
+int BoxGrid::row(int y) {
+	int dy = y - this->minY;
+	return dy >= 0 ? dy / this->cell : -((this->cell - 1 - dy) / this->cell);
+}
+
+/**
+ * Compute the overlap of two 1:1 aspect ratio bounding boxes as a ratio of the second box's area
+ * @param  {std::array<int, 3>} a First bounding box [x, y, s]
+ * @param  {std::array<int, 3>} b Second bounding box [x, y, s]
+ * @return {Float}                Overlap ratio
+ */
+float overlapRatio(std::array<int, 3>& a, std::array<int, 3>& b) {
+	int xx1 = std::max(a[0], b[0]);
+	int yy1 = std::max(a[1], b[1]);
+	int xx2 = std::min(a[0] + a[2], b[0] + b[2]) - 1;
+	int yy2 = std::min(a[1] + a[2], b[1] + b[2]) - 1;
+	int w = std::max(0, xx2 - xx1 + 1);
+	int h = std::max(0, yy2 - yy1 + 1);
+	return float(w * h) / (b[2] * b[2]);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+#include <array>
+
+class BoxGrid {
+	public:
+		BoxGrid();
+		BoxGrid(std::vector<std::array<int, 3>>& boxes, bool single);
+		void build(std::vector<std::array<int, 3>>& boxes, bool single);
+		int col(int x);
+		int row(int y);
+		int cell;
+		int cols;
+		int rows;
+		int minX;
+		int minY;
+		std::vector<int> start;
+		std::vector<int> count;
+		std::vector<int> bucket;
+		std::vector<int> bucketOf;
+};
+
+float overlapRatio(std::array<int, 3>& a, std::array<int, 3>& b);
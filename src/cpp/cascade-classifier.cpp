@@ -1,4 +1,5 @@
 #include <vector>
+#include <algorithm>
 
 #include "cascade-classifier.h"
 #include "integral-image.h"
@@ -10,6 +11,7 @@
  */
 CascadeClassifier::CascadeClassifier(int baseResolution) {
 	this->baseResolution = baseResolution;
+	this->revision = 0;
 }
 
 /**
@@ -19,6 +21,7 @@ CascadeClassifier::CascadeClassifier(int baseResolution) {
  */
 CascadeClassifier::CascadeClassifier(int baseResolution, std::vector<StrongClassifier> sc) {
 	this->baseResolution = baseResolution;
+	this->revision = 0;
 	this->strongClassifiers = sc;
 }
 
@@ -31,19 +34,57 @@ void CascadeClassifier::scale(float factor) {
 	for (int i = 0; i < this->strongClassifiers.size(); i += 1) this->strongClassifiers[i].scale(factor);
 }
 
+/**
+ * Build the set of scaled copies of a cascade classifier that fit within an image
+ * Each copy is scaled by factor relative to the one before it, starting from the base resolution
+ * @param  {Float}                          factor The factor by which to scale between copies
+ * @param  {Int}                            w      Width of the image
+ * @param  {Int}                            h      Height of the image
+ * @return {std::vector<CascadeClassifier>}        Scaled cascade classifiers, smallest first
+ */
+std::vector<CascadeClassifier> CascadeClassifier::pyramid(float factor, int w, int h) {
+	std::vector<CascadeClassifier> scales;
+	CascadeClassifier cc(*this);
+	while (cc.baseResolution < w && cc.baseResolution < h) {
+		scales.push_back(cc);
+		cc.scale(factor);
+		if (cc.baseResolution <= scales.back().baseResolution) break;
+	}
+	return scales;
+}
+
 /**
  * Add a strong classifier as a layer to a cascade classifier
+ * Bumps the revision, so detectors holding scaled copies of the cascade know to rebuild them
  * @param {StrongClassifier} sc The strong classifier to add
  */
 void CascadeClassifier::add(StrongClassifier sc) {
 	this->strongClassifiers.push_back(sc);
+	this->revision += 1;
 }
 
 /**
  * Remove the most recently added strong classifier associated with a cascade classifier
+ * Bumps the revision, so detectors holding scaled copies of the cascade know to rebuild them
  */
 void CascadeClassifier::removeLast() {
 	this->strongClassifiers.pop_back();
+	this->revision += 1;
+}
+
+/**
+ * Destructively limit the depth of a cascade classifier and shift its stage thresholds
+ * Detectors apply this to the scaled copies they compile from a loaded model, which is never changed, so each
+ * deployment can trade recall and precision for speed without retraining. A positive offset raises a stage's
+ * threshold, rejecting more subwindows
+ * @param {Int}                maxStages Number of stages to keep (0 keeps every stage)
+ * @param {std::vector<float>} offsets   Amount to add to each stage's threshold, by stage, missing stages are left as is
+ */
+void CascadeClassifier::tune(int maxStages, std::vector<float>& offsets) {
+	if (maxStages > 0 && maxStages < this->strongClassifiers.size()) this->strongClassifiers.resize(maxStages);
+	for (int i = 0; i < std::min(offsets.size(), this->strongClassifiers.size()); i += 1) {
+		this->strongClassifiers[i].threshold += offsets[i];
+	}
 }
 
 /**
@@ -52,16 +93,35 @@ void CascadeClassifier::removeLast() {
  * @param  {Int}           sx       Subwindow x offset
  * @param  {Int}           sy       Subwindow y offset
  * @param  {Float}         mean     The mean of the values within the subwindow (for post-normalization)
- * @param  {Float}         sd       The standard deviation of the values within the subwindow (for post normalization)
+ * @param  {Float}         invsd    The inverse standard deviation of the values within the subwindow (for post normalization)
  * @return {Bool}                   True for positive detection, false for negative
  */
-bool CascadeClassifier::classify(IntegralImage& integral, int sx, int sy, float mean, float sd) {
+bool CascadeClassifier::classify(IntegralImage& integral, int sx, int sy, float mean, float invsd) {
 	for (int i = 0; i < this->strongClassifiers.size(); i += 1) {
-		if (this->strongClassifiers[i].classify(integral, sx, sy, mean, sd) == false) return false;
+		if (this->strongClassifiers[i].classify(integral, sx, sy, mean, invsd) == false) return false;
 	}
 	return true;
 }
 
+/**
+ * Evaluate a region of an integral image, running stages until one rejects it
+ * @param  {IntegralImage} integral The integral image to evaluate
+ * @param  {Int}           sx       Subwindow x offset
+ * @param  {Int}           sy       Subwindow y offset
+ * @param  {Float}         mean     The mean of the values within the subwindow (for post-normalization)
+ * @param  {Float}         invsd    The inverse standard deviation of the values within the subwindow (for post normalization)
+ * @param  {Float}         margin   Set to the score minus the threshold of the last stage run, negative if that stage rejected
+ * @return {Int}                    Number of stages passed, which equals the number of stages for a positive detection
+ */
+int CascadeClassifier::evaluate(IntegralImage& integral, int sx, int sy, float mean, float invsd, float& margin) {
+	margin = 0;
+	for (int i = 0; i < this->strongClassifiers.size(); i += 1) {
+		margin = this->strongClassifiers[i].score(integral, sx, sy, mean, invsd) - this->strongClassifiers[i].threshold;
+		if (margin < 0) return i;
+	}
+	return this->strongClassifiers.size();
+}
+
 /**
  * Get false positive rate for a cascade classifier
  * @param  {std::vector<IntegralImage>} negativeValidationSet A set of negative images to test
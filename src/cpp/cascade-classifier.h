@@ -12,11 +12,15 @@ class CascadeClassifier {
 		CascadeClassifier(int baseResolution);
 		CascadeClassifier(int baseResolution, std::vector<StrongClassifier> sc);
 		void scale(float factor);
+		std::vector<CascadeClassifier> pyramid(float factor, int w, int h);
 		void add(StrongClassifier sc);
 		void removeLast();
-		bool classify(IntegralImage& integral, int sx, int sy, float mean, float sd);
+		void tune(int maxStages, std::vector<float>& offsets);
+		bool classify(IntegralImage& integral, int sx, int sy, float mean, float invsd);
+		int evaluate(IntegralImage& integral, int sx, int sy, float mean, float invsd, float& margin);
 		float getFPR(std::vector<IntegralImage>& negativeValidationSet);
 		float getFNR(std::vector<IntegralImage>& positiveValidationSet);
 		int baseResolution;
+		int revision;
 		std::vector<StrongClassifier> strongClassifiers;
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include <cstring>
+#include <cerrno>
+#include <cstddef>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "detection-protocol.h"
+
+// Messages are copied to and from the socket as is, which matches the protocol only on little-endian hosts
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "The detection protocol is little-endian and big-endian hosts are not supported"
+#endif
+
+static_assert(sizeof(RequestHeader) == 64, "RequestHeader must match the detection protocol");
+static_assert(sizeof(ResponseHeader) == 32, "ResponseHeader must match the detection protocol");
+static_assert(sizeof(ServerStats) == 64, "ServerStats must match the detection protocol");
+
+/**
+ * Read an exact number of bytes from a socket, retrying short and interrupted reads
+ * @param  {Int}   fd   The socket
+ * @param  {Void*} buf  Where to store the bytes
+ * @param  {Size}  size Number of bytes to read
+ * @return {Bool}       True if every byte was read, false if the peer hung up first or the read failed
+ */
+bool readFully(int fd, void* buf, std::size_t size) {
+	char* p = static_cast<char*>(buf);
+	while (size > 0) {
+		ssize_t n = read(fd, p, size);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+/**
+ * Read and throw away an exact number of bytes from a socket
+ * @param  {Int}  fd   The socket
+ * @param  {Size} size Number of bytes to skip
+ * @return {Bool}      True if every byte was read, false if the peer hung up first or the read failed
+ */
+bool skipFully(int fd, std::size_t size) {
+	char buf[4096];
+	while (size > 0) {
+		std::size_t n = size < sizeof(buf) ? size : sizeof(buf);
+		if (!readFully(fd, buf, n)) return false;
+		size -= n;
+	}
+	return true;
+}
+
+/**
+ * Write an exact number of bytes to a socket, retrying short and interrupted writes
+ * Writing to a peer that has hung up raises SIGPIPE, which programs using this should ignore
+ * @param  {Int}   fd   The socket
+ * @param  {Void*} buf  The bytes
+ * @param  {Size}  size Number of bytes to write
+ * @return {Bool}       True if every byte was written
+ */
+bool writeFully(int fd, const void* buf, std::size_t size) {
+	const char* p = static_cast<const char*>(buf);
+	while (size > 0) {
+		ssize_t n = write(fd, p, size);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+/**
+ * Connect to a detection server
+ * @param  {Char*} path Path of the server's Unix domain socket
+ * @return {Int}        The connected socket, or -1 if the server can't be reached
+ */
+int connectToServer(const char path[]) {
+	sockaddr_un address;
+	if (std::strlen(path) >= sizeof(address.sun_path)) return -1;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	std::strcpy(address.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Detection protocol: a client sends a request header, followed for detection requests by the frame's luma plane,
+// width * height bytes row by row. The server answers each request with a response header followed by count
+// detection records, seven 32-bit elements [x, y, s, depth, margin, neighbors, label] each where margin is a float,
+// or for stats requests by a ServerStats record. Responses carry the id of their request and may arrive out of
+// order when a client has several requests in flight. Every field is 32 bits and little-endian
+const uint32_t REQUEST_MAGIC = 0x51524657;
+const uint32_t RESPONSE_MAGIC = 0x53524657;
+const uint32_t PROTOCOL_VERSION = 1;
+const uint32_t MAX_FRAME_SIDE = 8192;
+
+// Smallest scale step the server accepts. Smaller steps build a pyramid of hundreds of scaled cascades per session
+const float MIN_STEP = 1.05f;
+
+enum RequestType {
+	REQUEST_DETECT,
+	REQUEST_STATS
+};
+
+enum ResponseStatus {
+	STATUS_OK = 0,
+	STATUS_MALFORMED = -1,
+	STATUS_UNKNOWN_MODEL = -2,
+	STATUS_BAD_SIZE = -3
+};
+
+struct RequestHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t type;
+	uint32_t id;
+	uint32_t model;
+	uint32_t width;
+	uint32_t height;
+	float step;
+	float delta;
+	int32_t pp;
+	float othresh;
+	int32_t nthresh;
+	float minsd;
+	int32_t mindepth;
+	uint32_t reserved[2];
+};
+
+struct ResponseHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t id;
+	int32_t status;
+	uint32_t count;
+	float queueTime;
+	float detectTime;
+	uint32_t reserved;
+};
+
+struct ServerStats {
+	uint32_t connections;
+	uint32_t requests;
+	uint32_t completed;
+	uint32_t failed;
+	uint32_t batches;
+	uint32_t workers;
+	float uptime;
+	float throughput;
+	float meanBatch;
+	float meanQueue;
+	float maxQueue;
+	float meanDetect;
+	float maxDetect;
+	float p50Latency;
+	float p99Latency;
+	float maxLatency;
+};
+
+bool readFully(int fd, void* buf, std::size_t size);
+bool skipFully(int fd, std::size_t size);
+bool writeFully(int fd, const void* buf, std::size_t size);
+int connectToServer(const char path[]);
@@ -0,0 +1,462 @@
+#include <vector>
+#include <deque>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "detection-server.h"
+#include "detection-protocol.h"
+#include "cascade-classifier.h"
+#include "detector.h"
+
+// Sessions each worker keeps, for the model, step and delta combinations it has seen most recently
+const int WORKER_SESSIONS = 8;
+
+// Seconds a write to a client may block before the client is given up on, so a client that stops reading can't hold
+// a worker forever
+const int SEND_TIMEOUT = 10;
+
+// Unanswered requests a connection may have, in batches, before the server stops reading from it
+const int PENDING_BATCHES = 2;
+
+// Bytes of frames the queue may hold across every connection. A larger frame is let in only when the queue is empty
+const std::size_t MAX_QUEUED_BYTES = std::size_t(256) << 20;
+
+// Largest frame buffer a spare job keeps for reuse, so one large frame doesn't hold its memory for good
+const std::size_t MAX_SPARE_BYTES = std::size_t(4) << 20;
+
+// Milliseconds the accept thread waits before retrying when it can't accept, as when out of file descriptors
+const int ACCEPT_BACKOFF = 50;
+
+/**
+ * Get the latency histogram bucket for a latency
+ * @param  {Double} ms Latency in milliseconds
+ * @return {Int}       The bucket
+ */
+static int latencyBucket(double ms) {
+	double us = std::max(1.0, ms * 1000);
+	return std::min(LATENCY_BUCKETS - 1, int(std::log2(us) * 8));
+}
+
+/**
+ * Get the latency in the middle of a latency histogram bucket
+ * @param  {Int}   bucket The bucket
+ * @return {Float}        Latency in milliseconds
+ */
+static float bucketLatency(int bucket) {
+	return std::exp2((bucket + 0.5) / 8) / 1000;
+}
+
+/**
+ * Constructor
+ * A connection is read by its own thread and written to by whichever threads answer its requests, one at a time
+ * @param {Int} fd The connected socket
+ */
+ServerConnection::ServerConnection(int fd) {
+	this->fd = fd;
+	this->pending = 0;
+	this->closed = false;
+}
+
+/**
+ * Constructor
+ * A detection server answers detection requests from local clients over a Unix domain socket. Each connection has a
+ * thread that reads its requests into a shared queue, so clients can have several requests in flight. Workers take
+ * the queue in batches of up to batch requests, which amortizes waking a worker over several requests under load
+ * and lets a batch's requests for the same session run back to back. Each worker keeps its own detector sessions
+ * for the model, step and delta combinations it has seen, and sessions grow to fit the largest frame they meet, so
+ * in the steady state a request allocates nothing on the detection path
+ * @param {std::vector<CascadeClassifier*>} models  The cascade classifiers to detect with, indexed by request
+ * @param {Int}                             workers Number of worker threads
+ * @param {Int}                             batch   Most requests a worker takes from the queue at once
+ */
+DetectionServer::DetectionServer(std::vector<CascadeClassifier*>& models, int workers, int batch) {
+	this->models = models;
+	this->batch = std::max(1, batch);
+	this->listenFd = -1;
+	this->stopping = false;
+	this->draining = false;
+	this->queuedBytes = 0;
+	this->startTime = std::chrono::steady_clock::now();
+	this->requests = 0;
+	this->completed = 0;
+	this->failed = 0;
+	this->batches = 0;
+	this->batched = 0;
+	this->queueSum = 0;
+	this->queueMax = 0;
+	this->detectSum = 0;
+	this->detectMax = 0;
+	this->latencyMax = 0;
+	std::fill(this->latencies, this->latencies + LATENCY_BUCKETS, 0);
+	for (int i = 0; i < std::max(1, workers); i += 1) this->workers.emplace_back(&DetectionServer::work, this);
+}
+
+/**
+ * Destructor
+ */
+DetectionServer::~DetectionServer() {
+	this->stop();
+	for (int i = 0; i < this->spare.size(); i += 1) delete this->spare[i];
+}
+
+/**
+ * Start accepting connections on a Unix domain socket
+ * A socket file left at the path by a previous server is replaced
+ * @param  {Char*} path Path of the socket
+ * @return {Bool}       True if the server is listening
+ */
+bool DetectionServer::listen(const char path[]) {
+	sockaddr_un address;
+	if (std::strlen(path) >= sizeof(address.sun_path)) return false;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	std::strcpy(address.sun_path, path);
+
+	this->listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (this->listenFd < 0) return false;
+	unlink(path);
+	if (bind(this->listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(this->listenFd, 64) != 0) {
+		close(this->listenFd);
+		this->listenFd = -1;
+		return false;
+	}
+	this->path = path;
+	this->acceptor = std::thread(&DetectionServer::accept, this);
+	return true;
+}
+
+/**
+ * Stop the server
+ * New connections are refused and open connections are hung up on, after the requests already read from them have
+ * been answered
+ */
+void DetectionServer::stop() {
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		if (this->stopping) return;
+		this->stopping = true;
+	}
+	this->room.notify_all();
+	if (this->listenFd >= 0) {
+		shutdown(this->listenFd, SHUT_RDWR);
+		this->acceptor.join();
+		close(this->listenFd);
+		unlink(this->path.c_str());
+	}
+
+	// Readers see end of file, wait for their connection's requests to be answered, and exit
+	for (int i = 0; i < this->connections.size(); i += 1) shutdown(this->connections[i]->fd, SHUT_RD);
+	for (int i = 0; i < this->connections.size(); i += 1) {
+		this->connections[i]->reader.join();
+		delete this->connections[i];
+	}
+	this->connections.clear();
+
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->draining = true;
+	}
+	this->ready.notify_all();
+	for (int i = 0; i < this->workers.size(); i += 1) this->workers[i].join();
+}
+
+/**
+ * Get the server's counters
+ * @return {ServerStats} Open connections, requests read, answered with detections and answered with an error,
+ *                       batches taken by workers, number of workers, seconds since the server started, requests
+ *                       answered per second, mean requests per batch, mean and max time requests waited in the
+ *                       queue, mean and max detection time, and median, 99th percentile and max latency from
+ *                       receipt to answer, in milliseconds. Percentiles are accurate to within 5 percent
+ */
+ServerStats DetectionServer::stats() {
+	std::lock_guard<std::mutex> guard(this->lock);
+	ServerStats stats;
+	std::memset(&stats, 0, sizeof(stats));
+	for (int i = 0; i < this->connections.size(); i += 1) stats.connections += !this->connections[i]->closed;
+	stats.requests = this->requests;
+	stats.completed = this->completed;
+	stats.failed = this->failed;
+	stats.batches = this->batches;
+	stats.workers = this->workers.size();
+	stats.uptime = std::chrono::duration<float>(std::chrono::steady_clock::now() - this->startTime).count();
+	stats.throughput = stats.uptime > 0 ? this->completed / stats.uptime : 0;
+	stats.meanBatch = this->batches ? float(this->batched) / this->batches : 0;
+	stats.meanQueue = this->completed ? this->queueSum / this->completed : 0;
+	stats.maxQueue = this->queueMax;
+	stats.meanDetect = this->completed ? this->detectSum / this->completed : 0;
+	stats.maxDetect = this->detectMax;
+	stats.maxLatency = this->latencyMax;
+
+	long long seen = 0;
+	for (int i = 0; i < LATENCY_BUCKETS; i += 1) {
+		seen += this->latencies[i];
+		if (stats.p50Latency == 0 && seen * 2 >= this->completed && seen > 0) stats.p50Latency = bucketLatency(i);
+		if (stats.p99Latency == 0 && seen * 100 >= this->completed * 99 && seen > 0) stats.p99Latency = bucketLatency(i);
+	}
+	stats.p50Latency = std::min(stats.p50Latency, stats.maxLatency);
+	stats.p99Latency = std::min(stats.p99Latency, stats.maxLatency);
+	return stats;
+}
+
+/**
+ * Check a request header
+ * @param  {RequestHeader} request The request header
+ * @return {Int}                   STATUS_OK, or the status to answer the request with
+ */
+int DetectionServer::validate(RequestHeader& request) {
+	if (request.magic != REQUEST_MAGIC || request.version != PROTOCOL_VERSION) return STATUS_MALFORMED;
+	if (request.type == REQUEST_STATS) return STATUS_OK;
+	if (request.type != REQUEST_DETECT) return STATUS_MALFORMED;
+	if (request.model >= this->models.size()) return STATUS_UNKNOWN_MODEL;
+	if (request.width == 0 || request.height == 0 || request.width > MAX_FRAME_SIDE || request.height > MAX_FRAME_SIDE) {
+		return STATUS_BAD_SIZE;
+	}
+	if (!(request.step >= MIN_STEP && request.step < 16) || !(request.delta > 0 && request.delta < 64)) return STATUS_MALFORMED;
+	if (request.pp < 0 || request.pp > 2) return STATUS_MALFORMED;
+	if (!std::isfinite(request.othresh) || !std::isfinite(request.minsd)) return STATUS_MALFORMED;
+	return STATUS_OK;
+}
+
+/**
+ * Accept thread loop
+ * Connections whose reader has finished are reaped as new ones arrive
+ */
+void DetectionServer::accept() {
+	while (true) {
+		int fd = ::accept(this->listenFd, nullptr, nullptr);
+		int error = errno;
+		std::unique_lock<std::mutex> guard(this->lock);
+		if (this->stopping) {
+			if (fd >= 0) close(fd);
+			return;
+		}
+
+		// Errors like running out of file descriptors last until something is freed, so retrying at once would spin
+		if (fd < 0) {
+			guard.unlock();
+			if (error != EINTR && error != ECONNABORTED) std::this_thread::sleep_for(std::chrono::milliseconds(ACCEPT_BACKOFF));
+			continue;
+		}
+		timeval timeout = {SEND_TIMEOUT, 0};
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		for (int i = 0; i < this->connections.size(); i += 1) {
+			if (!this->connections[i]->closed) continue;
+			this->connections[i]->reader.join();
+			delete this->connections[i];
+			this->connections.erase(this->connections.begin() + i);
+			i -= 1;
+		}
+		ServerConnection* connection = new ServerConnection(fd);
+		this->connections.push_back(connection);
+		connection->reader = std::thread(&DetectionServer::read, this, connection);
+	}
+}
+
+/**
+ * Connection reader thread loop
+ * Stats requests are answered right away. A malformed request is answered with its status and the connection is
+ * hung up on, since the rest of the stream can't be trusted. A detect request with a frame size in range is rejected
+ * only after its frame is read, so the client can finish writing it and read the answer. A connection's next frame is
+ * not read while it has too many requests unanswered or the queue holds too many frame bytes, which leaves the client
+ * blocked in its write until there is room
+ * @param {ServerConnection} connection The connection
+ */
+void DetectionServer::read(ServerConnection* connection) {
+	while (true) {
+		RequestHeader request;
+		if (!readFully(connection->fd, &request, sizeof(request))) break;
+		std::chrono::steady_clock::time_point received = std::chrono::steady_clock::now();
+
+		int status = this->validate(request);
+		if (status != STATUS_OK) {
+			bool framed = request.magic == REQUEST_MAGIC && request.version == PROTOCOL_VERSION && request.type == REQUEST_DETECT &&
+			              request.width > 0 && request.width <= MAX_FRAME_SIDE && request.height > 0 && request.height <= MAX_FRAME_SIDE;
+			if (framed) skipFully(connection->fd, std::size_t(request.width) * request.height);
+			ResponseHeader header = {RESPONSE_MAGIC, PROTOCOL_VERSION, request.id, status, 0, 0, 0, 0};
+			{
+				std::lock_guard<std::mutex> guard(this->lock);
+				this->requests += 1;
+				this->failed += 1;
+			}
+			this->respond(connection, header, nullptr, 0);
+			break;
+		}
+		if (request.type == REQUEST_STATS) {
+			ServerStats stats = this->stats();
+			ResponseHeader header = {RESPONSE_MAGIC, PROTOCOL_VERSION, request.id, STATUS_OK, 1, 0, 0, 0};
+			if (!this->respond(connection, header, &stats, sizeof(stats))) break;
+			continue;
+		}
+
+		ServerJob* job;
+		std::size_t size = std::size_t(request.width) * request.height;
+		{
+			std::unique_lock<std::mutex> guard(this->lock);
+			auto fits = [&] {
+				return connection->pending < this->batch * PENDING_BATCHES && 
+				       (this->queuedBytes == 0 || this->queuedBytes + size <= MAX_QUEUED_BYTES);
+			};
+			this->room.wait(guard, [&] { return this->stopping || fits(); });
+			if (!fits()) break;
+			this->queuedBytes += size;
+			if (this->spare.empty()) {
+				job = new ServerJob();
+			} else {
+				job = this->spare.back();
+				this->spare.pop_back();
+			}
+		}
+		job->connection = connection;
+		job->request = request;
+		job->luma.resize(size);
+		if (!readFully(connection->fd, job->luma.data(), job->luma.size())) {
+			{
+				std::lock_guard<std::mutex> guard(this->lock);
+				this->recycle(job);
+			}
+			this->room.notify_all();
+			break;
+		}
+		job->received = received;
+
+		{
+			std::lock_guard<std::mutex> guard(this->lock);
+			this->requests += 1;
+			connection->pending += 1;
+			this->queue.push_back(job);
+		}
+		this->ready.notify_one();
+	}
+
+	// Hang up once every request read from the connection has been answered
+	std::unique_lock<std::mutex> guard(this->lock);
+	connection->drained.wait(guard, [&] { return connection->pending == 0; });
+	close(connection->fd);
+	connection->closed = true;
+}
+
+/**
+ * Write a response to a connection
+ * A write that fails, or times out on a client that has stopped reading, leaves the stream cut off mid response, so
+ * the connection is shut down. Its reader sees end of file, and later responses to it fail at once
+ * @param  {ServerConnection} connection The connection
+ * @param  {ResponseHeader}   header     The response header
+ * @param  {Void*}            body       The records that follow the header
+ * @param  {Size}             size       Size of the records in bytes
+ * @return {Bool}                        True if the whole response was written
+ */
+bool DetectionServer::respond(ServerConnection* connection, ResponseHeader& header, const void* body, std::size_t size) {
+	std::lock_guard<std::mutex> guard(connection->writeLock);
+	if (writeFully(connection->fd, &header, sizeof(header)) && (size == 0 || writeFully(connection->fd, body, size))) return true;
+	shutdown(connection->fd, SHUT_RDWR);
+	return false;
+}
+
+/**
+ * Put a job that is done with back in the spare jobs and free its place in the queue, with the server's lock held
+ * @param {ServerJob} job The job
+ */
+void DetectionServer::recycle(ServerJob* job) {
+	this->queuedBytes -= std::size_t(job->request.width) * job->request.height;
+	if (job->luma.capacity() > MAX_SPARE_BYTES) std::vector<unsigned char>().swap(job->luma);
+	this->spare.push_back(job);
+}
+
+/**
+ * Worker thread loop
+ */
+void DetectionServer::work() {
+	std::vector<WorkerSession> sessions;
+	std::vector<ServerJob*> jobs;
+	long long used = 0;
+
+	std::unique_lock<std::mutex> guard(this->lock);
+	while (true) {
+		this->ready.wait(guard, [&] { return this->draining || !this->queue.empty(); });
+		if (this->queue.empty()) break;
+		jobs.clear();
+		while (!this->queue.empty() && jobs.size() < this->batch) {
+			jobs.push_back(this->queue.front());
+			this->queue.pop_front();
+		}
+		this->batches += 1;
+		this->batched += jobs.size();
+		guard.unlock();
+
+		// Requests for the same session run back to back, in the order they arrived
+		std::stable_sort(jobs.begin(), jobs.end(), [](ServerJob* a, ServerJob* b) {
+			if (a->request.model != b->request.model) return a->request.model < b->request.model;
+			if (a->request.step != b->request.step) return a->request.step < b->request.step;
+			return a->request.delta < b->request.delta;
+		});
+
+		for (int i = 0; i < jobs.size(); i += 1) {
+			ServerJob* job = jobs[i];
+			RequestHeader& request = job->request;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			// Reuse this worker's session for the model, step and delta, or replace its least recently used one
+			int s = 0;
+			while (s < sessions.size() && (sessions[s].model != request.model || sessions[s].step != request.step ||
+			                               sessions[s].delta != request.delta)) s += 1;
+			if (s == sessions.size()) {
+				Detector* detector = new Detector(*this->models[request.model], request.width, request.height, request.step,
+				                                  request.delta);
+				if (sessions.size() < WORKER_SESSIONS) {
+					sessions.push_back({request.model, request.step, request.delta, 0, detector});
+				} else {
+					s = 0;
+					for (int j = 1; j < sessions.size(); j += 1) if (sessions[j].lastUsed < sessions[s].lastUsed) s = j;
+					delete sessions[s].detector;
+					sessions[s] = {request.model, request.step, request.delta, 0, detector};
+				}
+			}
+			used += 1;
+			sessions[s].lastUsed = used;
+			Detector* detector = sessions[s].detector;
+			if (detector->w != request.width || detector->h != request.height) detector->resize(request.width, request.height);
+
+			auto& found = detector->detectLuma(job->luma.data(), request.pp, request.othresh, request.nthresh, request.minsd,
+			                                   request.mindepth);
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			float queueTime = std::chrono::duration<float, std::milli>(start - job->received).count();
+			float detectTime = std::chrono::duration<float, std::milli>(end - start).count();
+
+			// Counted before answering, so a client that has its answer sees it in the stats
+			ResponseHeader header = {RESPONSE_MAGIC, PROTOCOL_VERSION, request.id, STATUS_OK, uint32_t(found.size()),
+			                         queueTime, detectTime, 0};
+			double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job->received).count();
+			guard.lock();
+			this->completed += 1;
+			this->queueSum += queueTime;
+			this->queueMax = std::max(this->queueMax, double(queueTime));
+			this->detectSum += detectTime;
+			this->detectMax = std::max(this->detectMax, double(detectTime));
+			this->latencyMax = std::max(this->latencyMax, latency);
+			this->latencies[latencyBucket(latency)] += 1;
+			guard.unlock();
+			this->respond(job->connection, header, found.data(), found.size() * sizeof(Detection));
+		}
+
+		guard.lock();
+		for (int i = 0; i < jobs.size(); i += 1) {
+			ServerConnection* connection = jobs[i]->connection;
+			connection->pending -= 1;
+			if (connection->pending == 0) connection->drained.notify_all();
+			this->recycle(jobs[i]);
+		}
+		this->room.notify_all();
+	}
+	guard.unlock();
+	for (int i = 0; i < sessions.size(); i += 1) delete sessions[i].detector;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+#include "cascade-classifier.h"
+#include "detector.h"
+#include "detection-protocol.h"
+
+// Latency histogram buckets, eight per doubling from 1 microsecond
+const int LATENCY_BUCKETS = 256;
+
+class ServerConnection {
+	public:
+		ServerConnection(int fd);
+		int fd;
+		int pending;
+		bool closed;
+		std::thread reader;
+		std::mutex writeLock;
+		std::condition_variable drained;
+};
+
+struct ServerJob {
+	ServerConnection* connection;
+	RequestHeader request;
+	std::vector<unsigned char> luma;
+	std::chrono::steady_clock::time_point received;
+};
+
+struct WorkerSession {
+	uint32_t model;
+	float step;
+	float delta;
+	long long lastUsed;
+	Detector* detector;
+};
+
+class DetectionServer {
+	public:
+		DetectionServer(std::vector<CascadeClassifier*>& models, int workers, int batch);
+		~DetectionServer();
+		bool listen(const char path[]);
+		void stop();
+		ServerStats stats();
+		int validate(RequestHeader& request);
+		void accept();
+		void read(ServerConnection* connection);
+		void work();
+		bool respond(ServerConnection* connection, ResponseHeader& header, const void* body, std::size_t size);
+		void recycle(ServerJob* job);
+		std::vector<CascadeClassifier*> models;
+		int batch;
+		int listenFd;
+		std::string path;
+		bool stopping;
+		bool draining;
+		std::chrono::steady_clock::time_point startTime;
+		std::deque<ServerJob*> queue;
+		std::vector<ServerJob*> spare;
+		std::vector<ServerConnection*> connections;
+		std::vector<std::thread> workers;
+		std::thread acceptor;
+		std::mutex lock;
+		std::condition_variable ready;
+		std::condition_variable room;
+		std::size_t queuedBytes;
+		long long requests;
+		long long completed;
+		long long failed;
+		long long batches;
+		long long batched;
+		double queueSum;
+		double queueMax;
+		double detectSum;
+		double detectMax;
+		double latencyMax;
+		long long latencies[LATENCY_BUCKETS];
+};
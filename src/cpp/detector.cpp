@@ -0,0 +1,240 @@
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
+
+#include "detector.h"
+#include "cascade-classifier.h"
+#include "integral-image.h"
+#include "window-stats.h"
+#include "sweep.h"
+#include "post-processor.h"
+#include "utility.h"
+#include "alloc-counter.h"
+#include "model-format.h"
+
+// Cache keys are only valid for the build that made them, since scaling a cascade classifier may change between
+// builds. Release builds should define this to their version, so that a rebuild doesn't throw away every cache
+#ifndef WASMFACE_BUILD_ID
+#define WASMFACE_BUILD_ID __DATE__ " " __TIME__
+#endif
+
+/**
+ * Constructor
+ * A detector is a session for frames of a given size. It owns the scaled cascade classifiers and every buffer that
+ * detection needs, and reuses them from frame to frame, so once the buffers have grown to fit a frame's detections
+ * detecting again makes no heap allocations. The cascade classifier must outlive the detector. Stages added to it
+ * later, as when a model loads progressively, are picked up on the next frame
+ * @param {CascadeClassifier} cc    The cascade classifier to detect with
+ * @param {Int}               w     Width of the frames to be processed
+ * @param {Int}               h     Height of the frames to be processed
+ * @param {Float}             step  Detector scale step to apply
+ * @param {Float}             delta Detector sweep delta to apply
+ */
+Detector::Detector(CascadeClassifier& cc, int w, int h, float step, float delta) {
+	this->source = &cc;
+	this->w = 0;
+	this->h = 0;
+	this->stride = std::max(1, int(step * delta));
+	this->step = step;
+	this->reach = 0;
+	this->revision = cc.revision;
+	this->generation = 0;
+	this->maxStages = 0;
+	this->windowCount = 0;
+	this->rejectedCount = 0;
+	std::fill(this->phaseTimes, this->phaseTimes + ALLOC_PHASES, 0);
+	this->resize(w, h);
+}
+
+/**
+ * Change the size of the frames to be processed
+ * Buffers grow to fit the largest frame seen and are never shrunk, so a detector can be shared by frames of
+ * different sizes, like a batch of thumbnails, and only allocates when it meets a frame larger than any before
+ * @param {Int} w Width of the frames to be processed
+ * @param {Int} h Height of the frames to be processed
+ */
+void Detector::resize(int w, int h) {
+	// Compiled code has the integral image stride built in
+	if (w != this->w) {
+		this->compiled.assign(this->scales.size(), nullptr);
+		this->generation += 1;
+	}
+	this->w = w;
+	this->h = h;
+
+	// The pyramid for a frame is the part of the pyramid for any larger frame with subwindows that fit
+	if (std::min(w, h) > this->reach) {
+		this->reach = std::min(w, h);
+		this->compile();
+	}
+	if (this->gray.size() < w * h * 4) this->gray.resize(w * h * 4);
+}
+
+/**
+ * Build the scaled cascade classifiers from the source cascade, limited and shifted by the detector's tuning
+ * Any compiled code for the previous scales is detached, and the generation is bumped so that code compiled for
+ * them can't be attached later
+ */
+void Detector::compile() {
+	this->scales = this->source->pyramid(this->step, this->reach, this->reach);
+	for (int i = 0; i < this->scales.size(); i += 1) this->scales[i].tune(this->maxStages, this->offsets);
+	this->compiled.assign(this->scales.size(), nullptr);
+	this->revision = this->source->revision;
+	this->generation += 1;
+}
+
+/**
+ * Set the depth limit and stage threshold offsets applied to the cascade classifier for this detector's frames
+ * The source cascade is left as is, so other detectors sharing it are unaffected
+ * @param {Int}                maxStages Number of stages to run (0 runs every stage)
+ * @param {std::vector<float>} offsets   Amount to add to each stage's threshold, by stage
+ */
+void Detector::tune(int maxStages, std::vector<float>& offsets) {
+	this->maxStages = maxStages;
+	this->offsets = offsets;
+	this->compile();
+}
+
+/**
+ * Fold bytes into a 64-bit FNV-1a hash
+ * @param  {Uint64} hash  The hash so far
+ * @param  {Void*}  bytes Pointer to the bytes to fold in
+ * @param  {Size}   size  Number of bytes
+ * @return {Uint64}       The new hash
+ */
+static uint64_t hashBytes(uint64_t hash, const void* bytes, std::size_t size) {
+	const unsigned char* p = static_cast<const unsigned char*>(bytes);
+	for (std::size_t i = 0; i < size; i += 1) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/**
+ * Compute a key for caching what is built from the scaled cascade classifiers, like compiled code
+ * It hashes everything they are built from: the build, the source cascade classifier, the scale step, the reach of
+ * the pyramid and the tuning. The integral image stride is not included
+ * @return {Uint64} The key
+ */
+uint64_t Detector::cacheKey() {
+	const char build[] = WASMFACE_BUILD_ID;
+	std::string model = cascadeToBinary(*this->source, 0, 0);
+	int32_t limits[3] = {this->reach, this->maxStages, int32_t(this->offsets.size())};
+
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	hash = hashBytes(hash, build, sizeof(build));
+	hash = hashBytes(hash, model.data(), model.size());
+	hash = hashBytes(hash, &this->step, sizeof(this->step));
+	hash = hashBytes(hash, limits, sizeof(limits));
+	return hashBytes(hash, this->offsets.data(), this->offsets.size() * sizeof(float));
+}
+
+/**
+ * Get the time since a point in time and move the point to now
+ * @param  {std::chrono::steady_clock::time_point} last The point in time
+ * @return {Double}                                     Elapsed time in milliseconds
+ */
+static double lap(std::chrono::steady_clock::time_point& last) {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double elapsed = std::chrono::duration<double, std::milli>(now - last).count();
+	last = now;
+	return elapsed;
+}
+
+/**
+ * Detect objects in an HTML5 ImageData buffer
+ * The time spent in each phase is left in phaseTimes, by allocation phase, with rebuilding the scales counted as other
+ * @param  {Unsigned char*}         inputBuf Pointer to an HTML5 ImageData buffer
+ * @param  {Int}                    pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}                  othresh  Overlap threshold for post processing
+ * @param  {Int}                    nthresh  Neighbor threshold for post processing
+ * @param  {Float}                  minsd    Minimum subwindow standard deviation (0 disables)
+ * @param  {Int}                    mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @return {std::vector<Detection>}          The post processed detections, valid until the next call
+ */
+std::vector<Detection>& Detector::detect(unsigned char inputBuf[], int pp, float othresh, int nthresh, float minsd, int mindepth) {
+	std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+	if (this->source->revision != this->revision) this->compile();
+	this->phaseTimes[ALLOC_OTHER] = lap(last);
+
+	{
+		AllocScope scope(ALLOC_GRAYSCALE);
+		toGrayscaleFloat(inputBuf, this->w, this->h, this->gray.data());
+	}
+	this->phaseTimes[ALLOC_GRAYSCALE] = lap(last);
+	return this->search(pp, othresh, nthresh, minsd, mindepth, last);
+}
+
+/**
+ * Detect objects in a luma plane, as sent by clients that have no use for color
+ * @param  {Unsigned char*}         luma     Pointer to the luma plane, one byte per pixel
+ * @param  {Int}                    pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}                  othresh  Overlap threshold for post processing
+ * @param  {Int}                    nthresh  Neighbor threshold for post processing
+ * @param  {Float}                  minsd    Minimum subwindow standard deviation (0 disables)
+ * @param  {Int}                    mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @return {std::vector<Detection>}          The post processed detections, valid until the next call
+ */
+std::vector<Detection>& Detector::detectLuma(const unsigned char luma[], int pp, float othresh, int nthresh, float minsd, int mindepth) {
+	std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+	if (this->source->revision != this->revision) this->compile();
+	this->phaseTimes[ALLOC_OTHER] = lap(last);
+
+	{
+		AllocScope scope(ALLOC_GRAYSCALE);
+		lumaToGrayscaleFloat(luma, this->w, this->h, this->gray.data());
+	}
+	this->phaseTimes[ALLOC_GRAYSCALE] = lap(last);
+	return this->search(pp, othresh, nthresh, minsd, mindepth, last);
+}
+
+/**
+ * Detect objects in the grayscale buffer, once detect or detectLuma has filled it
+ * @param  {Int}                                   pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}                                 othresh  Overlap threshold for post processing
+ * @param  {Int}                                   nthresh  Neighbor threshold for post processing
+ * @param  {Float}                                 minsd    Minimum subwindow standard deviation (0 disables)
+ * @param  {Int}                                   mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @param  {std::chrono::steady_clock::time_point} last     When the grayscale phase ended, moved along as each phase ends
+ * @return {std::vector<Detection>}                         The post processed detections, valid until the next call
+ */
+std::vector<Detection>& Detector::search(int pp, float othresh, int nthresh, float minsd, int mindepth,
+                                         std::chrono::steady_clock::time_point& last) {
+	{
+		AllocScope scope(ALLOC_INTEGRAL);
+		this->integral.compute(this->gray.data(), this->w, this->h, false, this->sumTable);
+		this->integralSquared.compute(this->gray.data(), this->w, this->h, true, this->sumTable);
+	}
+	this->phaseTimes[ALLOC_INTEGRAL] = lap(last);
+
+	// Sweep each scale over the post-normalized input image and collect detections
+	{
+		AllocScope scope(ALLOC_SWEEP);
+		this->found.clear();
+		this->windowCount = 0;
+		this->rejectedCount = 0;
+		for (int i = 0; i < this->scales.size(); i += 1) {
+			int s = this->scales[i].baseResolution;
+			if (s >= this->w || s >= this->h) break;
+			if (this->compiled[i]) {
+				this->rejectedCount += sweepCompiled(this->integral, this->integralSquared, this->stats, this->compiled[i], s, 
+				                                     this->scales[i].strongClassifiers.size(), 0, 0, this->w - s, this->h - s, 
+				                                     this->stride, minsd, mindepth, this->found);
+			} else {
+				this->rejectedCount += sweepScored(this->integral, this->integralSquared, this->stats, this->scales[i], 0, 0, 
+				                                   this->w - s, this->h - s, this->stride, minsd, mindepth, this->found);
+			}
+			this->windowCount += this->stats.pass.size();
+		}
+	}
+	this->phaseTimes[ALLOC_SWEEP] = lap(last);
+
+	AllocScope scope(ALLOC_POSTPROCESS);
+	std::vector<Detection>& result = this->post.run(this->found, pp, othresh, nthresh);
+	this->phaseTimes[ALLOC_POSTPROCESS] = lap(last);
+	return result;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <chrono>
+
+#include "cascade-classifier.h"
+#include "integral-image.h"
+#include "window-stats.h"
+#include "sweep.h"
+#include "post-processor.h"
+#include "alloc-counter.h"
+
+class Detector {
+	public:
+		Detector(CascadeClassifier& cc, int w, int h, float step, float delta);
+		void resize(int w, int h);
+		void compile();
+		void tune(int maxStages, std::vector<float>& offsets);
+		uint64_t cacheKey();
+		std::vector<Detection>& detect(unsigned char inputBuf[], int pp, float othresh, int nthresh, float minsd, int mindepth);
+		std::vector<Detection>& detectLuma(const unsigned char luma[], int pp, float othresh, int nthresh, float minsd, int mindepth);
+		std::vector<Detection>& search(int pp, float othresh, int nthresh, float minsd, int mindepth,
+		                               std::chrono::steady_clock::time_point& last);
+		int w;
+		int h;
+		int stride;
+		float step;
+		int reach;
+		int revision;
+		int generation;
+		int maxStages;
+		std::vector<float> offsets;
+		int windowCount;
+		int rejectedCount;
+		double phaseTimes[ALLOC_PHASES];
+		CascadeClassifier* source;
+		std::vector<CascadeClassifier> scales;
+		std::vector<CompiledCascade> compiled;
+		std::vector<float> gray;
+		std::vector<float> sumTable;
+		IntegralImage integral;
+		IntegralImage integralSquared;
+		WindowStats stats;
+		std::vector<Detection> found;
+		PostProcessor post;
+};
@@ -1,5 +1,3 @@
-#include <iostream>
-
 #include "haar-like.h"
 
 /**
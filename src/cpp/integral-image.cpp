@@ -2,28 +2,50 @@
 #include <cmath>
 
 #include "integral-image.h"
-#include "utility.h"
 #include "haar-like.h"
 
+/**
+ * Constructor
+ * Makes an empty integral image, to be filled by compute
+ */
+IntegralImage::IntegralImage() {
+	this->stride = 0;
+}
+
 /**
  * Constructor
  * @param {Float*} inputBuf Pointer to a buffer of input values in floating point ImageData pseudograyscale format
  * @param {Int}    w        Width of source image
  * @param {Int}    h        Height of source image
- * @param {Int}    size     Length of input buffer
  * @param {Bool}   squared  True produces an integral image derived from squared input values
  */
-IntegralImage::IntegralImage(float inputBuf[], int w, int h, int size, bool squared) {
-	this->data.resize(w, std::vector<float>(h, 0));
-	std::vector<float> sumTable(size);
-	for (int i = 3; i < size; i += 4) {
-		auto vec2 = offsetToVec2(i - 3, w);
-		int x = vec2[0];
-		int y = vec2[1];
-		float yP = y - 1 < 0 ? 0 : sumTable[i - w * 4];
-		float xP = x - 1 < 0 ? 0 : this->data[x - 1][y];
-		sumTable[i] = !squared ? yP + inputBuf[i] : yP + std::pow(inputBuf[i], 2);
-		this->data[x][y] = xP + sumTable[i];	
+IntegralImage::IntegralImage(float inputBuf[], int w, int h, bool squared) : IntegralImage() {
+	std::vector<float> sumTable;
+	this->compute(inputBuf, w, h, squared, sumTable);
+}
+
+/**
+ * Compute an integral image, reusing its storage from any previous image of the same size
+ * Values are stored row-major with a leading row and column of zeros, so data[(y + 1) * stride + x + 1]
+ * holds the sum of every value above and to the left of (x, y) inclusive
+ * @param {Float*}             inputBuf Pointer to a buffer of input values in floating point ImageData pseudograyscale format
+ * @param {Int}                w        Width of source image
+ * @param {Int}                h        Height of source image
+ * @param {Bool}               squared  True produces an integral image derived from squared input values
+ * @param {std::vector<float>} sumTable Workspace for the running column sums
+ */
+void IntegralImage::compute(float inputBuf[], int w, int h, bool squared, std::vector<float>& sumTable) {
+	if (this->stride != w + 1 || this->data.size() != (w + 1) * (h + 1)) {
+		this->stride = w + 1;
+		this->data.assign(this->stride * (h + 1), 0);
+	}
+	sumTable.assign(w, 0);
+	for (int y = 0; y < h; y += 1) {
+		float* row = &this->data[(y + 1) * this->stride + 1];
+		for (int x = 0, i = y * w * 4 + 3; x < w; x += 1, i += 4) {
+			sumTable[x] = !squared ? sumTable[x] + inputBuf[i] : sumTable[x] + std::pow(inputBuf[i], 2);
+			row[x] = row[x - 1] + sumTable[x];
+		}
 	}
 }
 
@@ -36,25 +58,9 @@ IntegralImage::IntegralImage(float inputBuf[], int w, int h, int size, bool squa
  * @return {Float} Sum
  */
 float IntegralImage::getRectangleSum(int x, int y, int w, int h) {
-	float sum;
-	if (x != 0 && y != 0) {
-		float a = this->data[x - 1][y - 1];
-		float b = this->data[x + w - 1][y - 1];
-		float c = this->data[x + w - 1][y + h - 1];
-		float d = this->data[x - 1][y + h - 1];
-		sum = c + a - (b + d);
-	} else if (x == 0 && y != 0) {
-		float b = this->data[x + w - 1][y - 1];
-		float c = this->data[x + w - 1][y + h - 1];
-		sum = c - b;
-	} else if (y == 0 && x != 0) {
-		float c = this->data[x + w - 1][y + h - 1];
-		float d = this->data[x - 1][y + h - 1];
-		sum = c - d;
-	} else {
-		sum = this->data[x + w - 1][y + h - 1];
-	}	
-	return sum;
+	const float* top = &this->data[y * this->stride + x];
+	const float* bottom = &this->data[(y + h) * this->stride + x];
+	return bottom[w] + top[0] - (top[w] + bottom[0]);
 }
 
 /**
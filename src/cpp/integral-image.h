@@ -6,9 +6,12 @@
 
 class IntegralImage {
 	public:
-		IntegralImage(float inputBuf[], int w, int h, int size, bool squared);
+		IntegralImage();
+		IntegralImage(float inputBuf[], int w, int h, bool squared);
+		void compute(float inputBuf[], int w, int h, bool squared, std::vector<float>& sumTable);
 		float computeFeature(Haarlike& haarlike, int sx, int sy);
 		std::vector<Haarlike> computeEntireFeatureSet(int s, int sx, int sy);
 		float getRectangleSum(int x, int y, int w, int h);
-		std::vector<std::vector<float>> data;
-};
\ No newline at end of file
+		int stride;
+		std::vector<float> data;
+};
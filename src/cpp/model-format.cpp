@@ -0,0 +1,234 @@
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#ifndef __EMSCRIPTEN__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "model-format.h"
+#include "cascade-classifier.h"
+#include "strong-classifier.h"
+#include "weak-classifier.h"
+
+// Records are copied to and from memory as is, which matches the format only on little-endian hosts
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "The binary model format is little-endian and big-endian hosts are not supported"
+#endif
+
+static_assert(sizeof(ModelHeader) == 32, "ModelHeader must match the binary model format");
+static_assert(sizeof(StageRecord) == 8, "StageRecord must match the binary model format");
+static_assert(sizeof(FeatureRecord) == 32, "FeatureRecord must match the binary model format");
+
+/**
+ * Serialize a cascade classifier in the binary model format
+ * @param  {CascadeClassifier} cascadeClassifier The cascade classifier to serialize
+ * @param  {Float}             fpr               False positive rate of the cascade classifier
+ * @param  {Float}             fnr               False negative rate of the cascade classifier
+ * @return {std::string}                         The serialized model
+ */
+std::string cascadeToBinary(CascadeClassifier& cascadeClassifier, float fpr, float fnr) {
+	std::vector<StrongClassifier>& sc = cascadeClassifier.strongClassifiers;
+	ModelHeader header = {MODEL_MAGIC, MODEL_VERSION, uint32_t(cascadeClassifier.baseResolution), uint32_t(sc.size()), 0, fpr, fnr, 0};
+	for (int i = 0; i < sc.size(); i += 1) header.featureCount += sc[i].weakClassifiers.size();
+
+	std::string bytes(sizeof(ModelHeader) + header.stageCount * sizeof(StageRecord) + header.featureCount * sizeof(FeatureRecord), 0);
+	char* p = &bytes[0];
+	std::memcpy(p, &header, sizeof(ModelHeader));
+	p += sizeof(ModelHeader);
+	for (int i = 0; i < sc.size(); i += 1) {
+		StageRecord stage = {sc[i].threshold, uint32_t(sc[i].weakClassifiers.size())};
+		std::memcpy(p, &stage, sizeof(StageRecord));
+		p += sizeof(StageRecord);
+	}
+	for (int i = 0; i < sc.size(); i += 1) {
+		for (int j = 0; j < sc[i].weakClassifiers.size(); j += 1) {
+			WeakClassifier& wc = sc[i].weakClassifiers[j];
+			FeatureRecord feature = {wc.haarlike.type, wc.haarlike.x, wc.haarlike.y, wc.haarlike.w, wc.haarlike.h, 
+			                         wc.polarity, wc.threshold, sc[i].weights[j]};
+			std::memcpy(p, &feature, sizeof(FeatureRecord));
+			p += sizeof(FeatureRecord);
+		}
+	}
+	return bytes;
+}
+
+/**
+ * Read and check the header and stage table of a model in the binary model format
+ * @param  {Unsigned char*} bytes  Pointer to the model, which may be incomplete
+ * @param  {Size}           size   Number of bytes of the model available
+ * @param  {ModelHeader}    header Where to store the header
+ * @return {Bool}                  True if the header and stage table are available, well formed and in a version of
+ *                                 the format this build can read
+ */
+static bool readHeader(const unsigned char bytes[], std::size_t size, ModelHeader& header) {
+	if (!bytes || size < sizeof(ModelHeader)) return false;
+	std::memcpy(&header, bytes, sizeof(ModelHeader));
+	if (header.magic != MODEL_MAGIC || header.version < 1 || header.version > MODEL_VERSION) return false;
+	if (header.baseResolution < 1 || header.baseResolution > INT32_MAX) return false;
+	if (header.stageCount > (size - sizeof(ModelHeader)) / sizeof(StageRecord)) return false;
+
+	std::size_t features = 0;
+	for (uint32_t i = 0; i < header.stageCount; i += 1) {
+		StageRecord stage;
+		std::memcpy(&stage, bytes + sizeof(ModelHeader) + i * sizeof(StageRecord), sizeof(StageRecord));
+		features += stage.featureCount;
+	}
+	return features == header.featureCount;
+}
+
+/**
+ * Check that a feature record is a known type of Haar-like feature that fits in the base resolution subwindow
+ * @param  {FeatureRecord} feature        The feature record
+ * @param  {Int}           baseResolution Width and height of the base resolution subwindow
+ * @return {Bool}                         True if the feature is well formed
+ */
+bool isValidFeature(const FeatureRecord& feature, int64_t baseResolution) {
+	// Width and height of each type of feature, in multiples of its rectangle size
+	const int spans[5][2] = {{2, 1}, {3, 1}, {1, 2}, {1, 3}, {2, 2}};
+	if (feature.type < 1 || feature.type > 5) return false;
+	if (feature.x < 0 || feature.y < 0 || feature.w < 1 || feature.h < 1) return false;
+	return feature.x + int64_t(feature.w) * spans[feature.type - 1][0] <= baseResolution && 
+	       feature.y + int64_t(feature.h) * spans[feature.type - 1][1] <= baseResolution;
+}
+
+/**
+ * Count the stages of a model in the binary model format that are complete in a prefix of it
+ * Features are stored in stage order after the stage table, so any prefix that holds the stage table holds some
+ * number of whole stages followed by part of the next. Every feature of a complete stage is checked
+ * @param  {Unsigned char*} bytes Pointer to the model, which may be incomplete
+ * @param  {Size}           size  Number of bytes of the model available
+ * @return {Int}                  Number of complete stages, or -1 if the header and stage table are incomplete or
+ *                                malformed, or a complete stage has a malformed feature
+ */
+int binaryStagesAvailable(const unsigned char bytes[], std::size_t size) {
+	ModelHeader header;
+	if (!readHeader(bytes, size, header)) return -1;
+	std::size_t end = sizeof(ModelHeader) + header.stageCount * sizeof(StageRecord);
+	int stages = 0;
+	for (uint32_t i = 0; i < header.stageCount; i += 1) {
+		StageRecord stage;
+		std::memcpy(&stage, bytes + sizeof(ModelHeader) + i * sizeof(StageRecord), sizeof(StageRecord));
+		if (stage.featureCount > (size - end) / sizeof(FeatureRecord)) break;
+		for (uint32_t j = 0; j < stage.featureCount; j += 1, end += sizeof(FeatureRecord)) {
+			FeatureRecord feature;
+			std::memcpy(&feature, bytes + end, sizeof(FeatureRecord));
+			if (!isValidFeature(feature, header.baseResolution)) return -1;
+		}
+		stages += 1;
+	}
+	return stages;
+}
+
+/**
+ * Check that a buffer holds a well formed and complete model in a version of the binary model format this build can read
+ * @param  {Unsigned char*} bytes Pointer to the buffer
+ * @param  {Size}           size  Size of the buffer in bytes
+ * @return {Bool}                 True if the buffer holds a readable model
+ */
+bool isBinaryModel(const unsigned char bytes[], std::size_t size) {
+	ModelHeader header;
+	return readHeader(bytes, size, header) && binaryStagesAvailable(bytes, size) == header.stageCount;
+}
+
+/**
+ * Add the stages of a model in the binary model format that a cascade classifier doesn't have yet
+ * Called as more of a model arrives, this grows the cascade stage by stage. There is nothing to parse: records have
+ * a fixed size and layout, so each is read straight out of the buffer
+ * @param  {CascadeClassifier} cc    The cascade classifier, holding some leading stages of the model or none
+ * @param  {Unsigned char*}    bytes Pointer to the model, which may be incomplete
+ * @param  {Size}              size  Number of bytes of the model available
+ * @return {Int}                     Number of stages added, or -1 if the model is malformed or doesn't match the cascade
+ */
+int appendFromBinary(CascadeClassifier& cc, const unsigned char bytes[], std::size_t size) {
+	ModelHeader header;
+	if (!readHeader(bytes, size, header) || header.baseResolution != cc.baseResolution) return -1;
+	int available = binaryStagesAvailable(bytes, size);
+	int have = cc.strongClassifiers.size();
+	if (available < 0 || have > header.stageCount) return -1;
+
+	const unsigned char* stages = bytes + sizeof(ModelHeader);
+	const unsigned char* features = stages + header.stageCount * sizeof(StageRecord);
+	for (int i = 0; i < available; i += 1) {
+		StageRecord stage;
+		std::memcpy(&stage, stages + i * sizeof(StageRecord), sizeof(StageRecord));
+		if (i < have) {
+			features += stage.featureCount * sizeof(FeatureRecord);
+			continue;
+		}
+
+		StrongClassifier sc;
+		sc.threshold = stage.threshold;
+		sc.weakClassifiers.resize(stage.featureCount);
+		sc.weights.resize(stage.featureCount);
+		for (uint32_t j = 0; j < stage.featureCount; j += 1, features += sizeof(FeatureRecord)) {
+			FeatureRecord feature;
+			std::memcpy(&feature, features, sizeof(FeatureRecord));
+			WeakClassifier& wc = sc.weakClassifiers[j];
+			wc.haarlike = Haarlike(feature.x, feature.y, feature.w, feature.h, feature.type);
+			wc.polarity = feature.polarity;
+			wc.threshold = feature.threshold;
+			sc.weights[j] = feature.weight;
+		}
+		cc.add(sc);
+	}
+	return std::max(0, available - have);
+}
+
+/**
+ * Construct a cascade classifier from a model in the binary model format
+ * @param  {Unsigned char*}     bytes Pointer to the model
+ * @param  {Size}               size  Size of the model in bytes
+ * @return {CascadeClassifier*}       A pointer to a new cascade classifier object, or nullptr if the model is malformed
+ */
+CascadeClassifier* cascadeFromBinary(const unsigned char bytes[], std::size_t size) {
+	if (!isBinaryModel(bytes, size)) return nullptr;
+	return cascadeFromBinaryPrefix(bytes, size);
+}
+
+/**
+ * Construct a cascade classifier from the leading stages of a model in the binary model format that have arrived
+ * Grow it with appendFromBinary as the rest arrives
+ * @param  {Unsigned char*}     bytes Pointer to the model, which may be incomplete
+ * @param  {Size}               size  Number of bytes of the model available
+ * @return {CascadeClassifier*}       A pointer to a new cascade classifier object, or nullptr if the model is malformed
+ *                                    or not a single stage has arrived
+ */
+CascadeClassifier* cascadeFromBinaryPrefix(const unsigned char bytes[], std::size_t size) {
+	if (binaryStagesAvailable(bytes, size) < 1) return nullptr;
+	ModelHeader header;
+	std::memcpy(&header, bytes, sizeof(ModelHeader));
+	CascadeClassifier* cc = new CascadeClassifier(header.baseResolution);
+	appendFromBinary(*cc, bytes, size);
+	return cc;
+}
+
+#ifndef __EMSCRIPTEN__
+/**
+ * Construct a cascade classifier from a binary model file
+ * The file is memory mapped and its records are read in place, so it is never copied into a buffer of our own
+ * @param  {Char*}              path Path to the model file
+ * @return {CascadeClassifier*}      A pointer to a new cascade classifier object, or nullptr if the file can't be read
+ *                                   or the model is malformed
+ */
+CascadeClassifier* loadBinaryModel(const char path[]) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return nullptr;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return nullptr;
+	}
+	void* bytes = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (bytes == MAP_FAILED) return nullptr;
+	CascadeClassifier* cc = cascadeFromBinary(static_cast<const unsigned char*>(bytes), st.st_size);
+	munmap(bytes, st.st_size);
+	return cc;
+}
+#endif
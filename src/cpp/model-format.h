@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "cascade-classifier.h"
+
+// Binary model format: a header, then one stage record per strong classifier, then one feature record per weak
+// classifier in stage order. Every field is 32 bits and little-endian
+const uint32_t MODEL_MAGIC = 0x4d434657;
+const uint32_t MODEL_VERSION = 1;
+
+struct ModelHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t baseResolution;
+	uint32_t stageCount;
+	uint32_t featureCount;
+	float fpr;
+	float fnr;
+	uint32_t reserved;
+};
+
+struct StageRecord {
+	float threshold;
+	uint32_t featureCount;
+};
+
+struct FeatureRecord {
+	int32_t type;
+	int32_t x;
+	int32_t y;
+	int32_t w;
+	int32_t h;
+	int32_t polarity;
+	float threshold;
+	float weight;
+};
+
+bool isValidFeature(const FeatureRecord& feature, int64_t baseResolution);
+std::string cascadeToBinary(CascadeClassifier& cascadeClassifier, float fpr, float fnr);
+int binaryStagesAvailable(const unsigned char bytes[], std::size_t size);
+bool isBinaryModel(const unsigned char bytes[], std::size_t size);
+int appendFromBinary(CascadeClassifier& cc, const unsigned char bytes[], std::size_t size);
+CascadeClassifier* cascadeFromBinary(const unsigned char bytes[], std::size_t size);
+CascadeClassifier* cascadeFromBinaryPrefix(const unsigned char bytes[], std::size_t size);
+#ifndef __EMSCRIPTEN__
+CascadeClassifier* loadBinaryModel(const char path[]);
+#endif
@@ -0,0 +1,293 @@
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <cfloat>
+
+#include "model-json.h"
+#include "cascade-classifier.h"
+#include "strong-classifier.h"
+#include "weak-classifier.h"
+#include "model-format.h"
+
+// Skipped values may nest arrays and objects this deep, which is far deeper than any model needs
+const int MAX_JSON_DEPTH = 64;
+
+// A streaming reader for JSON models. Values are consumed as they are read and stored straight into the cascade
+// being built, so no document tree is ever held in memory. Any JSON value the model schema doesn't use is skipped
+class JSONReader {
+	public:
+		JSONReader(const char text[]);
+		void skipSpace();
+		bool consume(char c);
+		bool key(char out[], int capacity);
+		bool number(double& out);
+		bool integer(int& out);
+		bool real(float& out);
+		bool skip(int depth = 0);
+		const char* p;
+		bool ok;
+};
+
+/**
+ * Constructor
+ * @param {Char*} text The JSON text to read, null terminated
+ */
+JSONReader::JSONReader(const char text[]) {
+	this->p = text;
+	this->ok = true;
+}
+
+/**
+ * Advance past whitespace
+ */
+void JSONReader::skipSpace() {
+	while (*this->p == ' ' || *this->p == '\n' || *this->p == '\r' || *this->p == '\t') this->p += 1;
+}
+
+/**
+ * Advance past a structural character if it is next
+ * @param  {Char} c The character
+ * @return {Bool}   True if it was next
+ */
+bool JSONReader::consume(char c) {
+	this->skipSpace();
+	if (*this->p != c) return false;
+	this->p += 1;
+	return true;
+}
+
+/**
+ * Read an object key and the colon after it. Keys longer than the buffer are truncated
+ * @param  {Char*} out      Buffer for the key
+ * @param  {Int}   capacity Size of the buffer
+ * @return {Bool}           False if the input is malformed
+ */
+bool JSONReader::key(char out[], int capacity) {
+	if (!this->consume('"')) return this->ok = false;
+	int n = 0;
+	while (*this->p && *this->p != '"') {
+		if (*this->p == '\\' && this->p[1]) this->p += 1;
+		if (n < capacity - 1) out[n++] = *this->p;
+		this->p += 1;
+	}
+	out[n] = 0;
+	if (!*this->p) return this->ok = false;
+	this->p += 1;
+	return this->ok = this->consume(':');
+}
+
+/**
+ * Read a number
+ * @param  {Double} out The number
+ * @return {Bool}       False if the input is malformed
+ */
+bool JSONReader::number(double& out) {
+	this->skipSpace();
+	char* end;
+	out = std::strtod(this->p, &end);
+	if (end == this->p) return this->ok = false;
+	this->p = end;
+	return true;
+}
+
+/**
+ * Read a number that must fit in an int
+ * @param  {Int}  out The number, truncated toward zero
+ * @return {Bool}     False if the input is malformed or the number is out of range
+ */
+bool JSONReader::integer(int& out) {
+	double value;
+	if (!this->number(value)) return false;
+	if (!(value >= INT_MIN && value <= INT_MAX)) return this->ok = false;
+	out = value;
+	return true;
+}
+
+/**
+ * Read a number that must fit in a float
+ * @param  {Float} out The number, rounded to the nearest float
+ * @return {Bool}      False if the input is malformed or the number is out of range
+ */
+bool JSONReader::real(float& out) {
+	double value;
+	if (!this->number(value)) return false;
+	if (!(value >= -FLT_MAX && value <= FLT_MAX)) return this->ok = false;
+	out = value;
+	return true;
+}
+
+/**
+ * Advance past a value of any type
+ * @param  {Int}  depth Number of arrays and objects the value is nested in
+ * @return {Bool}       False if the input is malformed or nested more than MAX_JSON_DEPTH deep
+ */
+bool JSONReader::skip(int depth) {
+	this->skipSpace();
+	char c = *this->p;
+	if (c == '"') {
+		this->p += 1;
+		while (*this->p && *this->p != '"') this->p += *this->p == '\\' && this->p[1] ? 2 : 1;
+		if (!*this->p) return this->ok = false;
+		this->p += 1;
+		return true;
+	}
+	if (c == '{' || c == '[') {
+		if (depth >= MAX_JSON_DEPTH) return this->ok = false;
+		char close = c == '{' ? '}' : ']';
+		this->p += 1;
+		if (this->consume(close)) return true;
+		do {
+			if (c == '{') {
+				char name[2];
+				if (!this->key(name, sizeof(name))) return false;
+			}
+			if (!this->skip(depth + 1)) return false;
+		} while (this->consume(','));
+		return this->ok = this->consume(close);
+	}
+	if (!std::strncmp(this->p, "true", 4) || !std::strncmp(this->p, "null", 4)) {
+		this->p += 4;
+		return true;
+	}
+	if (!std::strncmp(this->p, "false", 5)) {
+		this->p += 5;
+		return true;
+	}
+	double unused;
+	return this->number(unused);
+}
+
+/**
+ * Read a weak classifier object
+ * @param  {JSONReader}     reader The reader, positioned at the object
+ * @param  {WeakClassifier} wc     The weak classifier to fill in
+ * @return {Bool}                  False if the input is malformed
+ */
+static bool readWeakClassifier(JSONReader& reader, WeakClassifier& wc) {
+	if (!reader.consume('{')) return reader.ok = false;
+	if (reader.consume('}')) return true;
+	do {
+		char name[16];
+		if (!reader.key(name, sizeof(name))) return false;
+		int* field = nullptr;
+		if (!std::strcmp(name, "type")) field = &wc.haarlike.type;
+		else if (!std::strcmp(name, "w")) field = &wc.haarlike.w;
+		else if (!std::strcmp(name, "h")) field = &wc.haarlike.h;
+		else if (!std::strcmp(name, "x")) field = &wc.haarlike.x;
+		else if (!std::strcmp(name, "y")) field = &wc.haarlike.y;
+		else if (!std::strcmp(name, "polarity")) field = &wc.polarity;
+
+		if (field) {
+			reader.integer(*field);
+		} else if (!std::strcmp(name, "threshold")) {
+			reader.real(wc.threshold);
+		} else {
+			reader.skip();
+		}
+		if (!reader.ok) return false;
+	} while (reader.consume(','));
+	return reader.ok = reader.consume('}');
+}
+
+/**
+ * Read a strong classifier object
+ * Weights may come before or after the weak classifiers they belong to
+ * @param  {JSONReader}       reader The reader, positioned at the object
+ * @param  {StrongClassifier} sc     The strong classifier to fill in
+ * @return {Bool}                    False if the input is malformed
+ */
+static bool readStrongClassifier(JSONReader& reader, StrongClassifier& sc) {
+	if (!reader.consume('{')) return reader.ok = false;
+	if (reader.consume('}')) return true;
+	do {
+		char name[32];
+		if (!reader.key(name, sizeof(name))) return false;
+		if (!std::strcmp(name, "threshold")) {
+			reader.real(sc.threshold);
+		} else if (!std::strcmp(name, "weakClassifiers")) {
+			if (!reader.consume('[')) return reader.ok = false;
+			if (!reader.consume(']')) {
+				do {
+					sc.weakClassifiers.emplace_back();
+					if (!readWeakClassifier(reader, sc.weakClassifiers.back())) return false;
+				} while (reader.consume(','));
+				if (!reader.consume(']')) return reader.ok = false;
+			}
+		} else if (!std::strcmp(name, "weights")) {
+			if (!reader.consume('[')) return reader.ok = false;
+			if (!reader.consume(']')) {
+				do {
+					float value;
+					if (!reader.real(value)) return false;
+					sc.weights.push_back(value);
+				} while (reader.consume(','));
+				if (!reader.consume(']')) return reader.ok = false;
+			}
+		} else {
+			reader.skip();
+		}
+		if (!reader.ok) return false;
+	} while (reader.consume(','));
+	if (sc.weights.size() != sc.weakClassifiers.size()) return reader.ok = false;
+	return reader.ok = reader.consume('}');
+}
+
+/**
+ * Deserialize a cascade classifier from its JSON representation
+ * The model is read in one streaming pass that builds each strong classifier as its text goes by. No JSON document
+ * is built, so peak memory is the text plus the cascade, and nothing is looked up by key after it is read
+ * @param  {Char*}              model A JSON cascade classifier, as written by wasmface-trainer, null terminated
+ * @param  {Float*}             fpr   Where to store the model's false positive rate, if not null
+ * @param  {Float*}             fnr   Where to store the model's false negative rate, if not null
+ * @return {CascadeClassifier*}       A pointer to a new cascade classifier object, or nullptr if the model is malformed,
+ *                                    has a feature that isn't a known type or doesn't fit the base resolution, or is
+ *                                    followed by anything but whitespace
+ */
+CascadeClassifier* cascadeFromJSON(const char model[], float* fpr, float* fnr) {
+	JSONReader reader(model);
+	CascadeClassifier* cc = new CascadeClassifier(0);
+	if (!reader.consume('{')) reader.ok = false;
+	else if (!reader.consume('}')) {
+		do {
+			char name[32];
+			if (!reader.key(name, sizeof(name))) break;
+			if (!std::strcmp(name, "baseResolution")) {
+				reader.integer(cc->baseResolution);
+			} else if (!std::strcmp(name, "fpr") && fpr) {
+				reader.real(*fpr);
+			} else if (!std::strcmp(name, "fnr") && fnr) {
+				reader.real(*fnr);
+			} else if (!std::strcmp(name, "strongClassifiers")) {
+				if (!reader.consume('[')) reader.ok = false;
+				else if (!reader.consume(']')) {
+					do {
+						cc->strongClassifiers.emplace_back();
+						if (!readStrongClassifier(reader, cc->strongClassifiers.back())) break;
+					} while (reader.consume(','));
+					if (reader.ok && !reader.consume(']')) reader.ok = false;
+				}
+			} else {
+				reader.skip();
+			}
+		} while (reader.ok && reader.consume(','));
+		if (reader.ok && !reader.consume('}')) reader.ok = false;
+	}
+	reader.skipSpace();
+	if (*reader.p) reader.ok = false;
+
+	// Features are checked once the base resolution is known, since it may come after them
+	for (int i = 0; reader.ok && i < cc->strongClassifiers.size(); i += 1) {
+		for (int j = 0; j < cc->strongClassifiers[i].weakClassifiers.size(); j += 1) {
+			Haarlike& h = cc->strongClassifiers[i].weakClassifiers[j].haarlike;
+			FeatureRecord feature = {h.type, h.x, h.y, h.w, h.h, 0, 0, 0};
+			if (!isValidFeature(feature, cc->baseResolution)) reader.ok = false;
+		}
+	}
+
+	if (!reader.ok || cc->baseResolution <= 0) {
+		delete cc;
+		return nullptr;
+	}
+	return cc;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "cascade-classifier.h"
+
+CascadeClassifier* cascadeFromJSON(const char model[], float* fpr = nullptr, float* fnr = nullptr);
@@ -0,0 +1,121 @@
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+
+#include "motion-gate.h"
+#include "integral-image.h"
+#include "cascade-classifier.h"
+#include "window-stats.h"
+#include "sweep.h"
+
+/**
+ * Constructor
+ * @param {Int}   w         Width of the frames to be processed
+ * @param {Int}   h         Height of the frames to be processed
+ * @param {Int}   blockSize Width and height of the blocks that motion is measured over
+ * @param {Float} thresh    Minimum change in a block's mean or standard deviation luma that counts as motion
+ */
+MotionGate::MotionGate(int w, int h, int blockSize, float thresh) {
+	this->w = w;
+	this->h = h;
+	this->blockSize = std::max(1, blockSize);
+	this->cols = (w + this->blockSize - 1) / this->blockSize;
+	this->rows = (h + this->blockSize - 1) / this->blockSize;
+	this->thresh = thresh;
+	this->primed = false;
+	this->mean.resize(this->cols * this->rows, 0);
+	this->sd.resize(this->cols * this->rows, 0);
+	this->moved.resize(this->cols * this->rows, 0);
+	this->movedTable.resize((this->cols + 1) * (this->rows + 1), 0);
+}
+
+/**
+ * Measure the motion in a new frame relative to the last one
+ * Each block's luma mean and standard deviation come straight from the frame's integral images, so this
+ * costs a handful of lookups per block. Motion accumulates until the next call to clear()
+ * @param  {IntegralImage} integral        Integral image of the frame
+ * @param  {IntegralImage} integralSquared Integral image of the squared frame
+ * @return {Int}                           Number of blocks that have moved since the last call to clear()
+ */
+int MotionGate::update(IntegralImage& integral, IntegralImage& integralSquared) {
+	int count = 0;
+	for (int r = 0, i = 0; r < this->rows; r += 1) {
+		for (int c = 0; c < this->cols; c += 1, i += 1) {
+			int x = c * this->blockSize;
+			int y = r * this->blockSize;
+			int bw = std::min(this->blockSize, this->w - x);
+			int bh = std::min(this->blockSize, this->h - y);
+			float area = float(bw) * float(bh);
+			float mean = integral.getRectangleSum(x, y, bw, bh) / area;
+			float sd = std::sqrt(std::max(0.0f, integralSquared.getRectangleSum(x, y, bw, bh) / area - mean * mean));
+			if (!this->primed || std::abs(mean - this->mean[i]) > this->thresh || std::abs(sd - this->sd[i]) > this->thresh) {
+				this->moved[i] = 1;
+			}
+			this->mean[i] = mean;
+			this->sd[i] = sd;
+			count += this->moved[i];
+		}
+	}
+	this->primed = true;
+
+	// Summed-area table of moved blocks, so any rectangle of blocks can be tested for motion in constant time
+	for (int r = 0; r < this->rows; r += 1) {
+		for (int c = 0; c < this->cols; c += 1) {
+			int* row = &this->movedTable[(r + 1) * (this->cols + 1) + 1];
+			int* above = &this->movedTable[r * (this->cols + 1) + 1];
+			row[c] = this->moved[r * this->cols + c] + row[c - 1] + above[c] - above[c - 1];
+		}
+	}
+	return count;
+}
+
+/**
+ * Forget accumulated motion once it has been swept
+ */
+void MotionGate::clear() {
+	std::fill(this->moved.begin(), this->moved.end(), 0);
+}
+
+/**
+ * Sweep a cascade classifier over the subwindows that overlap at least one moved block
+ * Consecutive subwindows along a row are swept together
+ * @param  {IntegralImage}                   integral        Integral image of the frame
+ * @param  {IntegralImage}                   integralSquared Integral image of the squared frame
+ * @param  {WindowStats}                     stats           Workspace for subwindow statistics
+ * @param  {CascadeClassifier}               cc              The cascade classifier, scaled to the subwindow size
+ * @param  {Int}                             stride          Distance between neighboring subwindows
+ * @param  {Float}                           minsd           Minimum subwindow standard deviation (0 disables)
+ * @param  {std::vector<std::array<int, 3>>} roi             Where to accumulate bounding boxes of positive detections
+ * @return {Int}                                             Number of subwindows swept
+ */
+int MotionGate::sweep(IntegralImage& integral, IntegralImage& integralSquared, WindowStats& stats, CascadeClassifier& cc, 
+                      int stride, float minsd, std::vector<std::array<int, 3>>& roi) {
+	int s = cc.baseResolution;
+	int b = this->blockSize;
+	int windows = 0;
+	for (int y = 0; y < this->h - s; y += stride) {
+		int r0 = y / b;
+		int r1 = (y + s - 1) / b + 1;
+		int start = -1;
+		for (int x = 0; ; x += stride) {
+			bool inside = x < this->w - s;
+			bool moved = false;
+			if (inside) {
+				int c0 = x / b;
+				int c1 = (x + s - 1) / b + 1;
+				int n = this->movedTable[r1 * (this->cols + 1) + c1] - this->movedTable[r0 * (this->cols + 1) + c1] - 
+				        this->movedTable[r1 * (this->cols + 1) + c0] + this->movedTable[r0 * (this->cols + 1) + c0];
+				moved = n > 0;
+			}
+			if (moved && start < 0) start = x;
+			if (!moved && start >= 0) {
+				::sweep(integral, integralSquared, stats, cc, start, y, x, y + 1, stride, minsd, roi);
+				windows += stats.pass.size();
+				start = -1;
+			}
+			if (!inside) break;
+		}
+	}
+	return windows;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <array>
+
+#include "integral-image.h"
+#include "cascade-classifier.h"
+#include "window-stats.h"
+
+class MotionGate {
+	public:
+		MotionGate(int w, int h, int blockSize, float thresh);
+		int update(IntegralImage& integral, IntegralImage& integralSquared);
+		void clear();
+		int sweep(IntegralImage& integral, IntegralImage& integralSquared, WindowStats& stats, CascadeClassifier& cc, 
+		          int stride, float minsd, std::vector<std::array<int, 3>>& roi);
+		int w;
+		int h;
+		int blockSize;
+		int cols;
+		int rows;
+		float thresh;
+		bool primed;
+		std::vector<float> mean;
+		std::vector<float> sd;
+		std::vector<unsigned char> moved;
+		std::vector<int> movedTable;
+};
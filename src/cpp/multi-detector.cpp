@@ -0,0 +1,137 @@
+#include <vector>
+#include <algorithm>
+
+#include "multi-detector.h"
+#include "cascade-classifier.h"
+#include "integral-image.h"
+#include "window-stats.h"
+#include "sweep.h"
+#include "post-processor.h"
+#include "utility.h"
+#include "alloc-counter.h"
+
+/**
+ * Constructor
+ * A multi detector is a session that runs several cascade classifiers over frames of a fixed size. Grayscale
+ * conversion and both integral images are computed once per frame for every model. Scales of different models that
+ * share a subwindow size are swept together, so subwindow statistics are also computed once per size, and each
+ * subwindow is run through every model before moving to the next while its part of the integral image is in cache
+ * @param {std::vector<CascadeClassifier*>} models The cascade classifiers to detect with, labeled by index
+ * @param {Int}                             w      Width of the frames to be processed
+ * @param {Int}                             h      Height of the frames to be processed
+ * @param {Float}                           step   Detector scale step to apply
+ * @param {Float}                           delta  Detector sweep delta to apply
+ */
+MultiDetector::MultiDetector(std::vector<CascadeClassifier*>& models, int w, int h, float step, float delta) {
+	this->w = w;
+	this->h = h;
+	this->stride = std::max(1, int(step * delta));
+	this->step = step;
+	this->models = models;
+	this->windowCount = 0;
+	this->rejectedCount = 0;
+	this->build();
+
+	this->found.resize(models.size());
+	this->gray.resize(w * h * 4);
+	this->sumTable.resize(w);
+	this->integral.compute(this->gray.data(), w, h, false, this->sumTable);
+	this->integralSquared.compute(this->gray.data(), w, h, true, this->sumTable);
+}
+
+/**
+ * Group the scales of every model by subwindow size
+ * Called again when stages are added to any of the models, as when a model loads progressively
+ */
+void MultiDetector::build() {
+	this->levels.clear();
+	this->revisions.clear();
+	for (int i = 0; i < this->models.size(); i += 1) {
+		this->revisions.push_back(this->models[i]->revision);
+		auto scales = this->models[i]->pyramid(this->step, this->w, this->h);
+		for (int j = 0; j < scales.size(); j += 1) {
+			int s = scales[j].baseResolution;
+			int k = 0;
+			while (k < this->levels.size() && this->levels[k].s != s) k += 1;
+			if (k == this->levels.size()) this->levels.push_back({s, {}, {}, {}});
+			this->levels[k].labels.push_back(i);
+			this->levels[k].cascades.push_back(scales[j]);
+			this->levels[k].depths.push_back(0);
+		}
+	}
+	std::sort(this->levels.begin(), this->levels.end(), [](const ScaleLevel& a, const ScaleLevel& b) {
+		return a.s < b.s;
+	});
+}
+
+/**
+ * Detect objects in an HTML5 ImageData buffer with every model
+ * Post processing only merges detections made by the same model
+ * @param  {Unsigned char*}         inputBuf Pointer to an HTML5 ImageData buffer
+ * @param  {Int}                    pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}                  othresh  Overlap threshold for post processing
+ * @param  {Int}                    nthresh  Neighbor threshold for post processing
+ * @param  {Float}                  minsd    Minimum subwindow standard deviation (0 disables)
+ * @param  {Int}                    mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @return {std::vector<Detection>}          The post processed detections labeled by model, valid until the next call
+ */
+std::vector<Detection>& MultiDetector::detect(unsigned char inputBuf[], int pp, float othresh, int nthresh, float minsd, int mindepth) {
+	for (int i = 0; i < this->models.size(); i += 1) {
+		if (this->models[i]->revision == this->revisions[i]) continue;
+		this->build();
+		break;
+	}
+
+	{
+		AllocScope scope(ALLOC_GRAYSCALE);
+		toGrayscaleFloat(inputBuf, this->w, this->h, this->gray.data());
+	}
+
+	{
+		AllocScope scope(ALLOC_INTEGRAL);
+		this->integral.compute(this->gray.data(), this->w, this->h, false, this->sumTable);
+		this->integralSquared.compute(this->gray.data(), this->w, this->h, true, this->sumTable);
+	}
+
+	// Sweep each subwindow size once, running every model of that size over each subwindow in turn
+	{
+		AllocScope scope(ALLOC_SWEEP);
+		for (int i = 0; i < this->found.size(); i += 1) this->found[i].clear();
+		this->windowCount = 0;
+		this->rejectedCount = 0;
+		for (int i = 0; i < this->levels.size(); i += 1) {
+			auto& level = this->levels[i];
+			int s = level.s;
+			int models = level.cascades.size();
+			for (int j = 0; j < models; j += 1) {
+				int stages = level.cascades[j].strongClassifiers.size();
+				level.depths[j] = mindepth <= 0 || mindepth > stages ? stages : mindepth;
+			}
+
+			this->rejectedCount += this->stats.compute(this->integral, this->integralSquared, s, 0, 0, 
+			                                           this->w - s, this->h - s, this->stride, minsd);
+			this->windowCount += this->stats.pass.size();
+			for (int y = 0, k = 0; y < this->h - s; y += this->stride) {
+				for (int x = 0; x < this->w - s; x += this->stride, k += 1) {
+					if (!this->stats.pass[k]) continue;
+					for (int j = 0; j < models; j += 1) {
+						float margin;
+						int depth = level.cascades[j].evaluate(this->integral, x, y, this->stats.mean[k], this->stats.invsd[k], margin);
+						if (depth >= level.depths[j]) {
+							Detection detection = {x, y, s, depth, margin, 0, level.labels[j]};
+							this->found[level.labels[j]].push_back(detection);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	AllocScope scope(ALLOC_POSTPROCESS);
+	this->result.clear();
+	for (int i = 0; i < this->found.size(); i += 1) {
+		auto& processed = this->post.run(this->found[i], pp, othresh, nthresh);
+		this->result.insert(this->result.end(), processed.begin(), processed.end());
+	}
+	return this->result;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include "cascade-classifier.h"
+#include "integral-image.h"
+#include "window-stats.h"
+#include "sweep.h"
+#include "post-processor.h"
+
+struct ScaleLevel {
+	int s;
+	std::vector<int> labels;
+	std::vector<CascadeClassifier> cascades;
+	std::vector<int> depths;
+};
+
+class MultiDetector {
+	public:
+		MultiDetector(std::vector<CascadeClassifier*>& models, int w, int h, float step, float delta);
+		void build();
+		std::vector<Detection>& detect(unsigned char inputBuf[], int pp, float othresh, int nthresh, float minsd, int mindepth);
+		int w;
+		int h;
+		int stride;
+		float step;
+		std::vector<CascadeClassifier*> models;
+		std::vector<int> revisions;
+		int windowCount;
+		int rejectedCount;
+		std::vector<ScaleLevel> levels;
+		std::vector<float> gray;
+		std::vector<float> sumTable;
+		IntegralImage integral;
+		IntegralImage integralSquared;
+		WindowStats stats;
+		std::vector<std::vector<Detection>> found;
+		PostProcessor post;
+		std::vector<Detection> result;
+};
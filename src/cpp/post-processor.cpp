@@ -0,0 +1,359 @@
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+
+#include "post-processor.h"
+#include "sweep.h"
+#include "box-grid.h"
+
+/**
+ * Constructor
+ * A post processor owns the workspace for suppressing and grouping detections, and reuses it from call to call
+ */
+PostProcessor::PostProcessor() {
+}
+
+/**
+ * Apply non-maximum suppression to the post processor's boxes, keeping track of which boxes survive
+ * Bounding boxes are represented as [x, y, s] where s = width and height
+ * Boxes are picked in order of descending lower edge, and each pick suppresses the remaining boxes that it overlaps.
+ * Boxes are bucketed on a grid of cells as large as the largest box, so a pick only has to be compared against
+ * the boxes in its own cell and the eight around it
+ * The surviving boxes are stored in picked as [i, n] where i = index and n = number of neighbors
+ * @param {Float} thresh  The minimum overlap ratio required for suppression
+ * @param {Int}   nthresh The minimum number of neighboring boxes required for suppression
+ */
+void PostProcessor::pick(float thresh, int nthresh) {
+	auto& boxes = this->boxes;
+	int len = boxes.size();
+	this->picked.clear();
+	if (!len) return;
+
+	// Create an array of the indices that would sort our lower edges, ties broken by index
+	this->order.resize(len);
+	for (int i = 0; i < len; i += 1) this->order[i] = i;
+	// Breaking ties explicitly keeps the order stable without std::stable_sort's temporary buffer
+	std::sort(this->order.begin(), this->order.end(), [&boxes](int a, int b) {
+		int ea = boxes[a][1] + boxes[a][2];
+		int eb = boxes[b][1] + boxes[b][2];
+		return ea < eb || (ea == eb && a < b);
+	});
+
+	// A negative threshold suppresses boxes that don't overlap at all, so only then must every box be compared
+	auto& grid = this->grid;
+	grid.build(boxes, thresh < 0);
+
+	this->alive.assign(len, 1);
+	for (int k = len - 1; k >= 0; k -= 1) {
+		int n = this->order[k];
+		if (!this->alive[n]) continue;
+		this->alive[n] = 0;
+
+		// Suppress bounding boxes that overlap, compacting away dead entries as we go
+		int neighborsCount = 0;
+		int cx = grid.col(boxes[n][0]);
+		int cy = grid.row(boxes[n][1]);
+		for (int by = std::max(0, cy - 1); by <= std::min(grid.rows - 1, cy + 1); by += 1) {
+			for (int bx = std::max(0, cx - 1); bx <= std::min(grid.cols - 1, cx + 1); bx += 1) {
+				int b = by * grid.cols + bx;
+				int kept = 0;
+				for (int i = 0; i < grid.count[b]; i += 1) {
+					int j = grid.bucket[grid.start[b] + i];
+					if (!this->alive[j]) continue;
+					if (overlapRatio(boxes[n], boxes[j]) > thresh) {
+						this->alive[j] = 0;
+						neighborsCount += 1;
+					} else {
+						grid.bucket[grid.start[b] + kept] = j;
+						kept += 1;
+					}
+				}
+				grid.count[b] = kept;
+			}
+		}
+
+		// Also suppress boxes that do not have the minimum number of neighbors
+		if (neighborsCount >= nthresh) this->picked.push_back({n, neighborsCount});
+	}
+}
+
+/**
+ * Check whether a box from one patch of boxes could be linked to a box from another
+ * A patch is given as [x, y, s, c]: boxes of size s with their upper left corners in the c x c square at (x, y).
+ * Either box covering more than thresh of the other is the same as covering more than thresh of the smaller, and
+ * the overlap of two boxes can't be wider than the smaller box or than the reach of one box past the other's corner.
+ * For patches of one box each this is exact
+ * @param  {std::array<int, 4>} a      First patch [x, y, s, c]
+ * @param  {std::array<int, 4>} b      Second patch [x, y, s, c]
+ * @param  {Float}              thresh The minimum overlap ratio required to link two boxes
+ * @return {Bool}                      False if no box in one patch is linked to any box in the other
+ */
+static bool mayLink(const std::array<int, 4>& a, const std::array<int, 4>& b, float thresh) {
+	int s = std::min(a[2], b[2]);
+	int w = std::min({s, a[0] + a[3] - 1 + a[2] - b[0], b[0] + b[3] - 1 + b[2] - a[0]});
+	int h = std::min({s, a[1] + a[3] - 1 + a[2] - b[1], b[1] + b[3] - 1 + b[2] - a[1]});
+	return w > 0 && h > 0 && float(w * h) / (s * s) > thresh;
+}
+
+/**
+ * Label the post processor's boxes with clusters of overlapping boxes
+ * Two boxes are linked when either one covers more than thresh of the other, and clusters are the connected
+ * components of those links. Boxes of one size s whose corners are less than s * (1 - sqrt(thresh)) apart in both
+ * directions are always linked, so boxes are first sorted into cells that small, by size, and components are flood
+ * filled over cells rather than boxes. A dense cluster collapses into a few cells, and two cells are linked at the
+ * first linked pair of their boxes. Cells are bucketed on one grid per octave of box size, each with grid cells as large
+ * as its largest cell, so a cell only visits the grid cells its neighbors could be in on each grid. As in non-maximum
+ * suppression, each cell leaves the buckets as soon as it joins a component
+ * Clusters are numbered in order of their first box. The cluster of each box is stored in labels
+ * @param  {Float} thresh The minimum overlap ratio required to link two boxes
+ * @return {Int}          Number of clusters
+ */
+int PostProcessor::cluster(float thresh) {
+	auto& boxes = this->boxes;
+	int len = boxes.size();
+	this->labels.assign(len, -1);
+	if (!len) return 0;
+
+	// A negative threshold links boxes that don't overlap at all, so every box is in one cluster
+	if (thresh < 0) {
+		this->labels.assign(len, 0);
+		return 1;
+	}
+
+	// No box covers more than all of another, so a threshold of 1 or more leaves every box in a cluster of its own
+	if (thresh >= 1) {
+		for (int i = 0; i < len; i += 1) this->labels[i] = i;
+		return len;
+	}
+
+	// Sort the boxes into cells by size and position, rounding the cell size down so the guarantee holds. Identical
+	// boxes end up next to each other, so only the first of them needs comparing with other cells
+	double shrink = 1 - std::sqrt(double(thresh));
+	int minX = boxes[0][0];
+	int minY = boxes[0][1];
+	int minS = boxes[0][2];
+	for (int i = 0; i < len; i += 1) {
+		minX = std::min(minX, boxes[i][0]);
+		minY = std::min(minY, boxes[i][1]);
+		minS = std::min(minS, boxes[i][2]);
+	}
+	auto& keys = this->keys;
+	keys.resize(len);
+	for (int i = 0; i < len; i += 1) {
+		int c = std::max(1, int(boxes[i][2] * shrink));
+		keys[i] = {boxes[i][2], (boxes[i][1] - minY) / c, (boxes[i][0] - minX) / c, boxes[i][1], boxes[i][0], i};
+	}
+	std::sort(keys.begin(), keys.end());
+
+	// Cells are stored as patches [x, y, s, c], in order of size, so each octave's cells are a run of them
+	auto& cells = this->cells;
+	auto& cellStart = this->cellStart;
+	auto& levelStart = this->levelStart;
+	cells.clear();
+	cellStart.clear();
+	levelStart.clear();
+	this->cellOf.resize(len);
+	for (int k = 0; k < len; k += 1) {
+		if (k == 0 || keys[k][0] != keys[k - 1][0] || keys[k][1] != keys[k - 1][1] || keys[k][2] != keys[k - 1][2]) {
+			int c = std::max(1, int(keys[k][0] * shrink));
+			cells.push_back({minX + keys[k][2] * c, minY + keys[k][1] * c, keys[k][0], c});
+			cellStart.push_back(k);
+			while (keys[k][0] >= minS << levelStart.size()) levelStart.push_back(cells.size() - 1);
+		}
+		this->cellOf[keys[k][5]] = cells.size() - 1;
+	}
+	cellStart.push_back(len);
+	levelStart.push_back(cells.size());
+	int levels = levelStart.size() - 1;
+
+	// Bucket each octave's cells by the square covering every box they could hold
+	this->covers.resize(levels);
+	this->grids.resize(levels);
+	for (int l = 0; l < levels; l += 1) {
+		this->covers[l].clear();
+		for (int i = levelStart[l]; i < levelStart[l + 1]; i += 1) {
+			this->covers[l].push_back({cells[i][0], cells[i][1], cells[i][2] + cells[i][3] - 1});
+		}
+		if (this->covers[l].size()) this->grids[l].build(this->covers[l], false);
+	}
+
+	auto linked = [&](int a, int b) {
+		if (!mayLink(cells[a], cells[b], thresh)) return false;
+		for (int k = cellStart[a]; k < cellStart[a + 1]; k += 1) {
+			if (k > cellStart[a] && keys[k][3] == keys[k - 1][3] && keys[k][4] == keys[k - 1][4]) continue;
+			std::array<int, 4> box = {keys[k][4], keys[k][3], keys[k][0], 1};
+			if (!mayLink(box, cells[b], thresh)) continue;
+			for (int m = cellStart[b]; m < cellStart[b + 1]; m += 1) {
+				if (m > cellStart[b] && keys[m][3] == keys[m - 1][3] && keys[m][4] == keys[m - 1][4]) continue;
+				if (mayLink(box, {keys[m][4], keys[m][3], keys[m][0], 1}, thresh)) return true;
+			}
+		}
+		return false;
+	};
+
+	auto& component = this->component;
+	component.assign(cells.size(), -1);
+	this->pending.clear();
+	int components = 0;
+	for (int i = 0; i < cells.size(); i += 1) {
+		if (component[i] >= 0) continue;
+		component[i] = components;
+		this->pending.push_back(i);
+		while (!this->pending.empty()) {
+			int n = this->pending.back();
+			this->pending.pop_back();
+
+			// A neighbor's corner is less than its grid's cell size to the left of or above this cell's corner, and
+			// within this cell's reach to the right of or below it
+			int reach = cells[n][2] + cells[n][3] - 2;
+			for (int l = 0; l < levels; l += 1) {
+				auto& grid = this->grids[l];
+				if (this->covers[l].empty()) continue;
+				int x0 = std::max(0, grid.col(cells[n][0] - grid.cell + 1));
+				int y0 = std::max(0, grid.row(cells[n][1] - grid.cell + 1));
+				int x1 = std::min(grid.cols - 1, grid.col(cells[n][0] + reach));
+				int y1 = std::min(grid.rows - 1, grid.row(cells[n][1] + reach));
+				for (int by = y0; by <= y1; by += 1) {
+					for (int bx = x0; bx <= x1; bx += 1) {
+						int g = by * grid.cols + bx;
+						int kept = 0;
+						for (int m = 0; m < grid.count[g]; m += 1) {
+							int j = grid.bucket[grid.start[g] + m];
+							int b = levelStart[l] + j;
+							if (component[b] >= 0) continue;
+							if (linked(n, b)) {
+								component[b] = components;
+								this->pending.push_back(b);
+							} else {
+								grid.bucket[grid.start[g] + kept] = j;
+								kept += 1;
+							}
+						}
+						grid.count[g] = kept;
+					}
+				}
+			}
+		}
+		components += 1;
+	}
+
+	// Components are found in order of their first cell, so renumber them in order of their first box
+	auto& order = this->order;
+	order.assign(components, -1);
+	int clusters = 0;
+	for (int i = 0; i < len; i += 1) {
+		int c = component[this->cellOf[i]];
+		if (order[c] < 0) {
+			order[c] = clusters;
+			clusters += 1;
+		}
+		this->labels[i] = order[c];
+	}
+	return clusters;
+}
+
+/**
+ * Apply post processing to a set of scored detections
+ * Non-maximum suppression keeps each pick's own score. Grouping averages each cluster's geometry and keeps the
+ * depth and margin of its best member, deepest first and then widest margin, so a cluster is as confident as its best window
+ * @param  {std::vector<Detection>} found   The scored detections
+ * @param  {Int}                    pp      0 for none, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}                  othresh Overlap threshold for post processing
+ * @param  {Int}                    nthresh Neighbor threshold for post processing
+ * @return {std::vector<Detection>}         The post processed detections with neighbor counts filled in, valid until the next run
+ */
+std::vector<Detection>& PostProcessor::run(std::vector<Detection>& found, int pp, float othresh, int nthresh) {
+	this->result.clear();
+	if (pp != 1 && pp != 2) {
+		this->result.insert(this->result.end(), found.begin(), found.end());
+		return this->result;
+	}
+
+	this->boxes.resize(found.size());
+	for (int i = 0; i < found.size(); i += 1) this->boxes[i] = {found[i].x, found[i].y, found[i].s};
+
+	if (pp == 1) {
+		this->pick(othresh, nthresh);
+		for (int i = 0; i < this->picked.size(); i += 1) {
+			Detection detection = found[this->picked[i][0]];
+			detection.neighbors = this->picked[i][1];
+			this->result.push_back(detection);
+		}
+		return this->result;
+	}
+
+	int clusters = this->cluster(othresh);
+	this->sums.assign(clusters, {0, 0, 0, 0});
+	this->best.resize(clusters);
+	for (int i = 0; i < found.size(); i += 1) {
+		int c = this->labels[i];
+		auto& sum = this->sums[c];
+		auto& best = this->best[c];
+		if (sum[3] == 0 || found[i].depth > best.depth || 
+		    (found[i].depth == best.depth && found[i].margin > best.margin)) best = found[i];
+		sum[0] += found[i].x;
+		sum[1] += found[i].y;
+		sum[2] += found[i].s;
+		sum[3] += 1;
+	}
+	for (int i = 0; i < clusters; i += 1) {
+		int neighbors = this->sums[i][3] - 1;
+		if (neighbors < nthresh) continue;
+		Detection averaged = {
+			int(std::lround(this->sums[i][0] / this->sums[i][3])), 
+			int(std::lround(this->sums[i][1] / this->sums[i][3])), 
+			int(std::lround(this->sums[i][2] / this->sums[i][3])), 
+			this->best[i].depth, 
+			this->best[i].margin, 
+			neighbors, 
+			this->best[i].label
+		};
+		this->result.push_back(averaged);
+	}
+	return this->result;
+}
+
+/**
+ * Apply post processing to a set of 1:1 aspect ratio bounding boxes, for detectors that don't score them
+ * @param  {std::vector<std::array<int, 3>>} found   The bounding boxes [x, y, s]
+ * @param  {Int}                             pp      0 for none, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}                           othresh Overlap threshold for post processing
+ * @param  {Int}                             nthresh Neighbor threshold for post processing
+ * @return {std::vector<std::array<int, 3>>}         The post processed bounding boxes, valid until the next run
+ */
+std::vector<std::array<int, 3>>& PostProcessor::run(std::vector<std::array<int, 3>>& found, int pp, float othresh, int nthresh) {
+	auto& merged = this->merged;
+	merged.clear();
+	if (pp != 1 && pp != 2) {
+		merged.insert(merged.end(), found.begin(), found.end());
+		return merged;
+	}
+
+	this->boxes.assign(found.begin(), found.end());
+	if (pp == 1) {
+		this->pick(othresh, nthresh);
+		for (int i = 0; i < this->picked.size(); i += 1) merged.push_back(found[this->picked[i][0]]);
+		return merged;
+	}
+
+	int clusters = this->cluster(othresh);
+	this->sums.assign(clusters, {0, 0, 0, 0});
+	for (int i = 0; i < found.size(); i += 1) {
+		auto& sum = this->sums[this->labels[i]];
+		sum[0] += found[i][0];
+		sum[1] += found[i][1];
+		sum[2] += found[i][2];
+		sum[3] += 1;
+	}
+	for (int i = 0; i < clusters; i += 1) {
+		int neighbors = this->sums[i][3] - 1;
+		if (neighbors < nthresh) continue;
+		merged.push_back({
+			int(std::lround(this->sums[i][0] / this->sums[i][3])), 
+			int(std::lround(this->sums[i][1] / this->sums[i][3])), 
+			int(std::lround(this->sums[i][2] / this->sums[i][3]))
+		});
+	}
+	return merged;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <array>
+
+#include "sweep.h"
+#include "box-grid.h"
+
+class PostProcessor {
+	public:
+		PostProcessor();
+		void pick(float thresh, int nthresh);
+		int cluster(float thresh);
+		std::vector<Detection>& run(std::vector<Detection>& found, int pp, float othresh, int nthresh);
+		std::vector<std::array<int, 3>>& run(std::vector<std::array<int, 3>>& found, int pp, float othresh, int nthresh);
+		std::vector<std::array<int, 3>> boxes;
+		std::vector<std::array<int, 2>> picked;
+		std::vector<int> labels;
+		std::vector<Detection> result;
+		BoxGrid grid;
+		std::vector<int> order;
+		std::vector<unsigned char> alive;
+		std::vector<int> pending;
+		std::vector<std::array<int, 6>> keys;
+		std::vector<std::array<int, 4>> cells;
+		std::vector<int> cellStart;
+		std::vector<int> cellOf;
+		std::vector<int> levelStart;
+		std::vector<std::vector<std::array<int, 3>>> covers;
+		std::vector<BoxGrid> grids;
+		std::vector<int> component;
+		std::vector<std::array<double, 4>> sums;
+		std::vector<Detection> best;
+		std::vector<std::array<int, 3>> merged;
+};
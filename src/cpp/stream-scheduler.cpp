@@ -0,0 +1,210 @@
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#include "stream-scheduler.h"
+#include "cascade-classifier.h"
+#include "sweep.h"
+#include "detector.h"
+
+/**
+ * Constructor
+ * A stream holds the detector state and detection settings of one video feed, and two frame buffers: the newest
+ * frame waiting for a worker, and the frame a worker is detecting in
+ * @param {CascadeClassifier} cc       The cascade classifier to detect with
+ * @param {Int}               w        Width of the stream's frames
+ * @param {Int}               h        Height of the stream's frames
+ * @param {Float}             step     Detector scale step to apply
+ * @param {Float}             delta    Detector sweep delta to apply
+ * @param {Int}               pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param {Float}             othresh  Overlap threshold for post processing
+ * @param {Int}               nthresh  Neighbor threshold for post processing
+ * @param {Float}             minsd    Minimum subwindow standard deviation (0 disables)
+ * @param {Int}               mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @param {Float}             target   Latency target in milliseconds, from a frame's submission to its detections
+ */
+Stream::Stream(CascadeClassifier& cc, int w, int h, float step, float delta, int pp, float othresh, int nthresh, 
+               float minsd, int mindepth, float target) : detector(cc, w, h, step, delta) {
+	this->pp = pp;
+	this->othresh = othresh;
+	this->nthresh = nthresh;
+	this->minsd = minsd;
+	this->mindepth = mindepth;
+	this->target = target;
+	this->busy = false;
+	this->hasPending = false;
+	this->pendingSequence = 0;
+	this->workingSequence = 0;
+	this->lastServed = 0;
+	this->startTime = std::chrono::steady_clock::now();
+	this->pending.resize(w * h * 4);
+	this->working.resize(w * h * 4);
+	this->latencySum = 0;
+	this->stats = {0, 0, 0, 0, -1, 0, 0, 0};
+}
+
+#ifdef WASMFACE_THREADS
+/**
+ * Constructor
+ * A stream scheduler runs detection for many video feeds on a fixed pool of worker threads. Each stream keeps only
+ * its newest frame: a frame submitted while an older one is still waiting replaces it, and the older frame is
+ * dropped rather than queued, so a stream that falls behind catches up on its next frame instead of building a
+ * backlog. Idle workers take the waiting frame with the earliest deadline, and streams with equal deadlines take
+ * turns. A deadline is the time the stream started waiting plus its latency target, and replacing a waiting frame
+ * does not move it, so a stream with a loose target is served later than one with a tight target but is never
+ * starved by it, even under overload.
+ * A stream is never worked on by two workers at once, so its detector state needs no locking
+ * @param {Int} workers Number of worker threads
+ */
+StreamScheduler::StreamScheduler(int workers) {
+	this->stopping = false;
+	this->served = 0;
+	for (int i = 0; i < std::max(1, workers); i += 1) this->workers.emplace_back(&StreamScheduler::work, this);
+}
+
+/**
+ * Destructor
+ * Frames still waiting are dropped, and frames being detected in are finished first
+ */
+StreamScheduler::~StreamScheduler() {
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->stopping = true;
+	}
+	this->ready.notify_all();
+	for (int i = 0; i < this->workers.size(); i += 1) this->workers[i].join();
+	for (int i = 0; i < this->streams.size(); i += 1) delete this->streams[i];
+}
+
+/**
+ * Add a stream
+ * @param  {CascadeClassifier} cc       The cascade classifier to detect with
+ * @param  {Int}               w        Width of the stream's frames
+ * @param  {Int}               h        Height of the stream's frames
+ * @param  {Float}             step     Detector scale step to apply
+ * @param  {Float}             delta    Detector sweep delta to apply
+ * @param  {Int}               pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}             othresh  Overlap threshold for post processing
+ * @param  {Int}               nthresh  Neighbor threshold for post processing
+ * @param  {Float}             minsd    Minimum subwindow standard deviation (0 disables)
+ * @param  {Int}               mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @param  {Float}             target   Latency target in milliseconds
+ * @return {Int}                        The stream's index
+ */
+int StreamScheduler::add(CascadeClassifier& cc, int w, int h, float step, float delta, int pp, float othresh, int nthresh, 
+                         float minsd, int mindepth, float target) {
+	Stream* stream = new Stream(cc, w, h, step, delta, pp, othresh, nthresh, minsd, mindepth, target);
+	std::lock_guard<std::mutex> guard(this->lock);
+	this->streams.push_back(stream);
+	return this->streams.size() - 1;
+}
+
+/**
+ * Submit a frame to a stream
+ * The frame is copied, so the caller may reuse its buffer as soon as this returns
+ * @param  {Int}            stream   Index of the stream
+ * @param  {Unsigned char*} inputBuf Pointer to an HTML5 ImageData buffer the size of the stream's frames
+ * @return {Int}                     Sequence number of the frame within its stream
+ */
+int StreamScheduler::submit(int stream, unsigned char inputBuf[]) {
+	std::unique_lock<std::mutex> guard(this->lock);
+	Stream* st = this->streams[stream];
+	st->pendingTime = std::chrono::steady_clock::now();
+	if (st->hasPending) st->stats.dropped += 1;
+	else st->waitingSince = st->pendingTime;
+	std::memcpy(st->pending.data(), inputBuf, st->pending.size());
+	st->hasPending = true;
+	st->pendingSequence = st->stats.submitted;
+	st->stats.submitted += 1;
+	guard.unlock();
+	this->ready.notify_one();
+	return st->pendingSequence;
+}
+
+/**
+ * Copy the detections from a stream's most recently processed frame
+ * @param  {Int}                    stream Index of the stream
+ * @param  {std::vector<Detection>} found  Vector to copy the detections to
+ * @return {Int}                           Sequence number of the frame the detections are from, -1 if none has been processed
+ */
+int StreamScheduler::read(int stream, std::vector<Detection>& found) {
+	std::lock_guard<std::mutex> guard(this->lock);
+	found = this->streams[stream]->result;
+	return this->streams[stream]->stats.sequence;
+}
+
+/**
+ * Get a stream's throughput and latency stats
+ * @param  {Int}         stream Index of the stream
+ * @return {StreamStats}        Frames submitted, processed, dropped and processed past the latency target, sequence
+ *                              number of the latest processed frame, mean and max latency in milliseconds, and
+ *                              processed frames per second since the stream was added
+ */
+StreamStats StreamScheduler::stats(int stream) {
+	std::lock_guard<std::mutex> guard(this->lock);
+	Stream* st = this->streams[stream];
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - st->startTime).count();
+	st->stats.fps = seconds > 0 ? st->stats.processed / seconds : 0;
+	return st->stats;
+}
+
+/**
+ * Pick the next frame to detect in, called with the lock held
+ * @return {Stream*} The idle stream with a waiting frame that has the earliest deadline, breaking ties by the stream
+ *                   served longest ago, or nullptr if no frame is waiting
+ */
+Stream* StreamScheduler::next() {
+	Stream* best = nullptr;
+	std::chrono::steady_clock::time_point bestDeadline;
+	for (int i = 0; i < this->streams.size(); i += 1) {
+		Stream* st = this->streams[i];
+		if (!st->hasPending || st->busy) continue;
+		auto deadline = st->waitingSince + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		                std::chrono::duration<float, std::milli>(st->target));
+		if (!best || deadline < bestDeadline || (deadline == bestDeadline && st->lastServed < best->lastServed)) {
+			best = st;
+			bestDeadline = deadline;
+		}
+	}
+	return best;
+}
+
+/**
+ * Worker thread loop
+ */
+void StreamScheduler::work() {
+	std::unique_lock<std::mutex> guard(this->lock);
+	while (true) {
+		Stream* st;
+		this->ready.wait(guard, [&] { return this->stopping || (st = this->next()) != nullptr; });
+		if (this->stopping) return;
+
+		// Take the waiting frame, leaving the pending buffer free for the next submission
+		std::swap(st->pending, st->working);
+		st->workingSequence = st->pendingSequence;
+		st->workingTime = st->pendingTime;
+		st->hasPending = false;
+		st->busy = true;
+		this->served += 1;
+		st->lastServed = this->served;
+		guard.unlock();
+
+		auto& found = st->detector.detect(st->working.data(), st->pp, st->othresh, st->nthresh, st->minsd, st->mindepth);
+		float latency = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - st->workingTime).count();
+
+		guard.lock();
+		st->result = found;
+		st->busy = false;
+		st->stats.processed += 1;
+		st->stats.sequence = st->workingSequence;
+		st->stats.late += latency > st->target;
+		st->latencySum += latency;
+		st->stats.meanLatency = st->latencySum / st->stats.processed;
+		st->stats.maxLatency = std::max(st->stats.maxLatency, latency);
+
+		// The stream may have had a frame submitted while it was busy
+		if (st->hasPending) this->ready.notify_one();
+	}
+}
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+
+#include "cascade-classifier.h"
+#include "sweep.h"
+#include "detector.h"
+#include "worker-threads.h"
+
+struct StreamStats {
+	int submitted;
+	int processed;
+	int dropped;
+	int late;
+	int sequence;
+	float meanLatency;
+	float maxLatency;
+	float fps;
+};
+
+class Stream {
+	public:
+		Stream(CascadeClassifier& cc, int w, int h, float step, float delta, int pp, float othresh, int nthresh, 
+		       float minsd, int mindepth, float target);
+		Detector detector;
+		int pp;
+		float othresh;
+		int nthresh;
+		float minsd;
+		int mindepth;
+		float target;
+		bool busy;
+		bool hasPending;
+		int pendingSequence;
+		int workingSequence;
+		long long lastServed;
+		std::chrono::steady_clock::time_point pendingTime;
+		std::chrono::steady_clock::time_point waitingSince;
+		std::chrono::steady_clock::time_point workingTime;
+		std::chrono::steady_clock::time_point startTime;
+		std::vector<unsigned char> pending;
+		std::vector<unsigned char> working;
+		std::vector<Detection> result;
+		double latencySum;
+		StreamStats stats;
+};
+
+#ifdef WASMFACE_THREADS
+class StreamScheduler {
+	public:
+		StreamScheduler(int workers);
+		~StreamScheduler();
+		int add(CascadeClassifier& cc, int w, int h, float step, float delta, int pp, float othresh, int nthresh, 
+		        float minsd, int mindepth, float target);
+		int submit(int stream, unsigned char inputBuf[]);
+		int read(int stream, std::vector<Detection>& found);
+		StreamStats stats(int stream);
+		Stream* next();
+		void work();
+		bool stopping;
+		long long served;
+		std::vector<Stream*> streams;
+		std::vector<std::thread> workers;
+		std::mutex lock;
+		std::condition_variable ready;
+};
+#endif
@@ -34,15 +34,15 @@ void StrongClassifier::add(WeakClassifier weakClassifier, float weight) {
 }
 
 /**
- * Classify a region of an integral image
- * @param  {IntegralImage}  integral The integral image to classify
+ * Score a region of an integral image as the weighted vote of the weak classifiers
+ * @param  {IntegralImage}  integral The integral image to score
  * @param  {Int}            sx       Subwindow x offset
  * @param  {Int}            sy       Subwindow y offset
  * @param  {Float}          mean     The mean of the values within the subwindow (for post-normalization)
- * @param  {Float}          sd       The standard deviation for the values within the subwindow (for post normalization)
- * @return {Bool}                    True for positive detection, false for negative
+ * @param  {Float}          invsd    The inverse standard deviation of the values within the subwindow (for post normalization)
+ * @return {Float}                   The score, which is compared against the threshold to classify
  */
-bool StrongClassifier::classify(IntegralImage& integral, int sx, int sy, float mean, float sd) {
+float StrongClassifier::score(IntegralImage& integral, int sx, int sy, float mean, float invsd) {
 	float score = 0;
 	for (int i = 0; i < this->weakClassifiers.size(); i += 1) {
 		float f = integral.computeFeature(this->weakClassifiers[i].haarlike, sx, sy);
@@ -51,11 +51,23 @@ bool StrongClassifier::classify(IntegralImage& integral, int sx, int sy, float m
 		} else if (this->weakClassifiers[i].haarlike.type == 4) {
 			f += (this->weakClassifiers[i].haarlike.w * this->weakClassifiers[i].haarlike.h * 3 * mean) / 3;
 		}
-		if (sd != 0) f /= sd;
+		f *= invsd;
 		score += this->weakClassifiers[i].classify(f) * this->weights[i];
 	}
+	return score;
+}
 
-	if (score >= this->threshold) return true;
+/**
+ * Classify a region of an integral image
+ * @param  {IntegralImage}  integral The integral image to classify
+ * @param  {Int}            sx       Subwindow x offset
+ * @param  {Int}            sy       Subwindow y offset
+ * @param  {Float}          mean     The mean of the values within the subwindow (for post-normalization)
+ * @param  {Float}          invsd    The inverse standard deviation of the values within the subwindow (for post normalization)
+ * @return {Bool}                    True for positive detection, false for negative
+ */
+bool StrongClassifier::classify(IntegralImage& integral, int sx, int sy, float mean, float invsd) {
+	if (this->score(integral, sx, sy, mean, invsd) >= this->threshold) return true;
 	else return false;
 }
 
@@ -13,7 +13,8 @@ class StrongClassifier {
 		StrongClassifier();
 		void scale(float factor);
 		void add(WeakClassifier weakClassifier, float weight);
-		bool classify(IntegralImage& integral, int sx, int sy, float mean, float sd);
+		float score(IntegralImage& integral, int sx, int sy, float mean, float invsd);
+		bool classify(IntegralImage& integral, int sx, int sy, float mean, float invsd);
 		void optimizeThreshold(std::vector<IntegralImage>& positiveValidationSet, float targetFNR);
 		float getFPR(std::vector<IntegralImage>& negativeValidationSet);
 		float getFNR(std::vector<IntegralImage>& positiveValidationSet);
@@ -0,0 +1,172 @@
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstdlib>
+
+#include "sweep.h"
+#include "integral-image.h"
+#include "cascade-classifier.h"
+#include "window-stats.h"
+
+/**
+ * Sweep a cascade classifier over a region of an integral image and collect detections
+ * Subwindow origins run from (x0, y0) in increments of stride, stopping before (x1, y1)
+ * @param  {IntegralImage}                   integral        Integral image of the input
+ * @param  {IntegralImage}                   integralSquared Integral image of the squared input
+ * @param  {WindowStats}                     stats           Workspace for subwindow statistics
+ * @param  {CascadeClassifier}               cc              The cascade classifier, scaled to the subwindow size
+ * @param  {Int}                             x0              X offset of the first subwindow
+ * @param  {Int}                             y0              Y offset of the first subwindow
+ * @param  {Int}                             x1              Subwindow x offsets must be less than this
+ * @param  {Int}                             y1              Subwindow y offsets must be less than this
+ * @param  {Int}                             stride          Distance between neighboring subwindows
+ * @param  {Float}                           minsd           Minimum subwindow standard deviation (0 disables)
+ * @param  {std::vector<std::array<int, 3>>} roi             Where to accumulate bounding boxes of positive detections
+ * @return {Int}                                             Number of subwindows rejected by the variance floor
+ */
+int sweep(IntegralImage& integral, IntegralImage& integralSquared, WindowStats& stats, CascadeClassifier& cc, 
+          int x0, int y0, int x1, int y1, int stride, float minsd, std::vector<std::array<int, 3>>& roi) {
+	int s = cc.baseResolution;
+	int rejected = stats.compute(integral, integralSquared, s, x0, y0, x1, y1, stride, minsd);
+	for (int y = y0, i = 0; y < y1; y += stride) {
+		for (int x = x0; x < x1; x += stride, i += 1) {
+			if (!stats.pass[i]) continue;
+			if (cc.classify(integral, x, y, stats.mean[i], stats.invsd[i])) {
+				std::array<int, 3> bounding = {x, y, s};
+				roi.push_back(bounding);
+			}
+		}
+	}
+	return rejected;
+}
+
+
+/**
+ * Sweep a cascade classifier over a region of an integral image and collect scored detections
+ * Subwindows that pass at least mindepth stages are kept along with how far they got, so near misses can be
+ * logged and thresholded later without sweeping again
+ * @param  {IntegralImage}          integral        Integral image of the input
+ * @param  {IntegralImage}          integralSquared Integral image of the squared input
+ * @param  {WindowStats}            stats           Workspace for subwindow statistics
+ * @param  {CascadeClassifier}      cc              The cascade classifier, scaled to the subwindow size
+ * @param  {Int}                    x0              X offset of the first subwindow
+ * @param  {Int}                    y0              Y offset of the first subwindow
+ * @param  {Int}                    x1              Subwindow x offsets must be less than this
+ * @param  {Int}                    y1              Subwindow y offsets must be less than this
+ * @param  {Int}                    stride          Distance between neighboring subwindows
+ * @param  {Float}                  minsd           Minimum subwindow standard deviation (0 disables)
+ * @param  {Int}                    mindepth        Minimum number of stages passed to keep a subwindow (0 keeps positive detections only)
+ * @param  {std::vector<Detection>} found           Where to accumulate scored detections
+ * @return {Int}                                    Number of subwindows rejected by the variance floor
+ */
+int sweepScored(IntegralImage& integral, IntegralImage& integralSquared, WindowStats& stats, CascadeClassifier& cc, 
+                int x0, int y0, int x1, int y1, int stride, float minsd, int mindepth, std::vector<Detection>& found) {
+	int s = cc.baseResolution;
+	int stages = cc.strongClassifiers.size();
+	if (mindepth <= 0 || mindepth > stages) mindepth = stages;
+	int rejected = stats.compute(integral, integralSquared, s, x0, y0, x1, y1, stride, minsd);
+	for (int y = y0, i = 0; y < y1; y += stride) {
+		for (int x = x0; x < x1; x += stride, i += 1) {
+			if (!stats.pass[i]) continue;
+			float margin;
+			int depth = cc.evaluate(integral, x, y, stats.mean[i], stats.invsd[i], margin);
+			if (depth >= mindepth) {
+				Detection detection = {x, y, s, depth, margin, 0, 0};
+				found.push_back(detection);
+			}
+		}
+	}
+	return rejected;
+}
+
+/**
+ * Sweep a compiled cascade classifier over a region of an integral image and collect scored detections
+ * Same as sweepScored, for a cascade classifier compiled to code with its features and thresholds built in
+ * @param  {IntegralImage}          integral        Integral image of the input, with the stride the cascade was compiled for
+ * @param  {IntegralImage}          integralSquared Integral image of the squared input
+ * @param  {WindowStats}            stats           Workspace for subwindow statistics
+ * @param  {CompiledCascade}        evaluate        The compiled cascade classifier
+ * @param  {Int}                    s               Subwindow size the cascade was compiled for
+ * @param  {Int}                    stages          Number of stages in the cascade
+ * @param  {Int}                    x0              X offset of the first subwindow
+ * @param  {Int}                    y0              Y offset of the first subwindow
+ * @param  {Int}                    x1              Subwindow x offsets must be less than this
+ * @param  {Int}                    y1              Subwindow y offsets must be less than this
+ * @param  {Int}                    stride          Distance between neighboring subwindows
+ * @param  {Float}                  minsd           Minimum subwindow standard deviation (0 disables)
+ * @param  {Int}                    mindepth        Minimum number of stages passed to keep a subwindow (0 keeps positive detections only)
+ * @param  {std::vector<Detection>} found           Where to accumulate scored detections
+ * @return {Int}                                    Number of subwindows rejected by the variance floor
+ */
+int sweepCompiled(IntegralImage& integral, IntegralImage& integralSquared, WindowStats& stats, CompiledCascade evaluate, 
+                  int s, int stages, int x0, int y0, int x1, int y1, int stride, float minsd, int mindepth, 
+                  std::vector<Detection>& found) {
+	if (mindepth <= 0 || mindepth > stages) mindepth = stages;
+	int rejected = stats.compute(integral, integralSquared, s, x0, y0, x1, y1, stride, minsd);
+	for (int y = y0, i = 0; y < y1; y += stride) {
+		const float* row = &integral.data[y * integral.stride];
+		for (int x = x0; x < x1; x += stride, i += 1) {
+			if (!stats.pass[i]) continue;
+			float margin;
+			int depth = evaluate(row + x, stats.mean[i], stats.invsd[i], &margin);
+			if (depth >= mindepth) {
+				Detection detection = {x, y, s, depth, margin, 0, 0};
+				found.push_back(detection);
+			}
+		}
+	}
+	return rejected;
+}
+
+/**
+ * Sweep the neighborhood of a bounding box at its own scale and the scales on either side
+ * Objects move little between video frames, so this is where to look for an object that was seen in the last one
+ * Subwindows are aligned to the same grid as a full sweep
+ * @param  {IntegralImage}                   integral        Integral image of the input
+ * @param  {IntegralImage}                   integralSquared Integral image of the squared input
+ * @param  {WindowStats}                     stats           Workspace for subwindow statistics
+ * @param  {std::vector<CascadeClassifier>}  scales          Scaled cascade classifiers, as built by CascadeClassifier::pyramid
+ * @param  {std::array<int, 3>}              box             The bounding box [x, y, s]
+ * @param  {Int}                             w               Width of the input
+ * @param  {Int}                             h               Height of the input
+ * @param  {Int}                             stride          Distance between neighboring subwindows
+ * @param  {Float}                           minsd           Minimum subwindow standard deviation (0 disables)
+ * @param  {std::vector<std::array<int, 3>>} roi             Where to accumulate bounding boxes of positive detections
+ * @return {Int}                                             Number of subwindows swept
+ */
+int sweepNeighborhood(IntegralImage& integral, IntegralImage& integralSquared, WindowStats& stats, 
+                      std::vector<CascadeClassifier>& scales, std::array<int, 3>& box, int w, int h, int stride, 
+                      float minsd, std::vector<std::array<int, 3>>& roi) {
+	int x = box[0];
+	int y = box[1];
+	int s = box[2];
+	int margin = s / 2;
+	int idx = nearestScale(scales, s);
+	int windows = 0;
+	for (int i = std::max(0, idx - 1); idx >= 0 && i <= idx + 1 && i < scales.size(); i += 1) {
+		int ss = scales[i].baseResolution;
+		int x0 = std::max(0, x - margin);
+		int y0 = std::max(0, y - margin);
+		x0 = (x0 + stride - 1) / stride * stride;
+		y0 = (y0 + stride - 1) / stride * stride;
+		int x1 = std::min(w - ss, x + s + margin - ss + 1);
+		int y1 = std::min(h - ss, y + s + margin - ss + 1);
+		sweep(integral, integralSquared, stats, scales[i], x0, y0, x1, y1, stride, minsd, roi);
+		windows += stats.pass.size();
+	}
+	return windows;
+}
+
+/**
+ * Find the scaled cascade classifier whose subwindow size is closest to a given size
+ * @param  {std::vector<CascadeClassifier>} scales Scaled cascade classifiers
+ * @param  {Int}                            s      Subwindow size
+ * @return {Int}                                   Index of the closest scale, or -1 if there are none
+ */
+int nearestScale(std::vector<CascadeClassifier>& scales, int s) {
+	int best = -1;
+	for (int i = 0; i < scales.size(); i += 1) {
+		if (best < 0 || std::abs(scales[i].baseResolution - s) < std::abs(scales[best].baseResolution - s)) best = i;
+	}
+	return best;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <array>
+
+#include "integral-image.h"
+#include "cascade-classifier.h"
+#include "window-stats.h"
+
+struct Detection {
+	int x;
+	int y;
+	int s;
+	int depth;
+	float margin;
+	int neighbors;
+	int label;
+};
+
+// A cascade classifier compiled for one subwindow size and integral image stride, with the same results as
+// CascadeClassifier::evaluate. window points to the integral image value at the subwindow origin
+typedef int (*CompiledCascade)(const float* window, float mean, float invsd, float* margin);
+
+int sweep(IntegralImage& integral, IntegralImage& integralSquared, WindowStats& stats, CascadeClassifier& cc, 
+          int x0, int y0, int x1, int y1, int stride, float minsd, std::vector<std::array<int, 3>>& roi);
+int sweepScored(IntegralImage& integral, IntegralImage& integralSquared, WindowStats& stats, CascadeClassifier& cc, 
+                int x0, int y0, int x1, int y1, int stride, float minsd, int mindepth, std::vector<Detection>& found);
+int sweepCompiled(IntegralImage& integral, IntegralImage& integralSquared, WindowStats& stats, CompiledCascade evaluate, 
+                  int s, int stages, int x0, int y0, int x1, int y1, int stride, float minsd, int mindepth, 
+                  std::vector<Detection>& found);
+int sweepNeighborhood(IntegralImage& integral, IntegralImage& integralSquared, WindowStats& stats, 
+                      std::vector<CascadeClassifier>& scales, std::array<int, 3>& box, int w, int h, int stride, 
+                      float minsd, std::vector<std::array<int, 3>>& roi);
+int nearestScale(std::vector<CascadeClassifier>& scales, int s);
@@ -0,0 +1,174 @@
+#include <vector>
+#include <array>
+#include <algorithm>
+
+#include "tracker.h"
+#include "cascade-classifier.h"
+#include "integral-image.h"
+#include "window-stats.h"
+#include "sweep.h"
+#include "motion-gate.h"
+#include "utility.h"
+
+/**
+ * Compute the intersection over union of two 1:1 aspect ratio bounding boxes
+ * @param  {std::array<int, 3>} a First bounding box [x, y, s]
+ * @param  {std::array<int, 3>} b Second bounding box [x, y, s]
+ * @return {Float}                Intersection over union
+ */
+static float iou(std::array<int, 3>& a, std::array<int, 3>& b) {
+	int w = std::max(0, std::min(a[0] + a[2], b[0] + b[2]) - std::max(a[0], b[0]));
+	int h = std::max(0, std::min(a[1] + a[2], b[1] + b[2]) - std::max(a[1], b[1]));
+	float intersection = float(w) * float(h);
+	return intersection / (float(a[2]) * float(a[2]) + float(b[2]) * float(b[2]) - intersection);
+}
+
+/**
+ * Constructor
+ * @param {CascadeClassifier} cc       The cascade classifier to detect with
+ * @param {Int}               w        Width of the frames to be processed
+ * @param {Int}               h        Height of the frames to be processed
+ * @param {Float}             step     Detector scale step to apply
+ * @param {Float}             delta    Detector sweep delta to apply
+ * @param {Int}               interval A full scan runs every interval frames
+ */
+Tracker::Tracker(CascadeClassifier& cc, int w, int h, float step, float delta, int interval) {
+	this->w = w;
+	this->h = h;
+	this->stride = std::max(1, int(step * delta));
+	this->interval = std::max(1, interval);
+	this->maxMisses = 2;
+	this->frame = 0;
+	this->nextId = 1;
+	this->refresh = 0;
+	this->nextRefresh = 0;
+	this->movedBlocks = 0;
+	this->gate = nullptr;
+	this->step = step;
+	this->source = &cc;
+	this->revision = cc.revision;
+	this->scales = cc.pyramid(step, w, h);
+	this->gray.resize(w * h * 4);
+}
+
+/**
+ * Destructor
+ */
+Tracker::~Tracker() {
+	delete this->gate;
+}
+
+/**
+ * Gate full scans on motion, for static cameras
+ * Once enabled, scheduled full scans only sweep subwindows that overlap a block that moved since the last scan,
+ * plus the neighborhoods of existing tracks. A true full scan still runs every refresh frames
+ * @param {Int}   blockSize Width and height of the blocks that motion is measured over (0 disables gating)
+ * @param {Float} thresh    Minimum change in a block's mean or standard deviation luma that counts as motion
+ * @param {Int}   refresh   Number of frames between true full scans
+ */
+void Tracker::setMotionGate(int blockSize, float thresh, int refresh) {
+	delete this->gate;
+	this->gate = blockSize > 0 ? new MotionGate(this->w, this->h, blockSize, thresh) : nullptr;
+	this->refresh = std::max(1, refresh);
+	this->nextRefresh = this->frame;
+}
+
+/**
+ * Detect objects in the next frame of a video stream
+ * Every interval frames the whole frame is scanned at every scale, or just its moved blocks when motion gating
+ * is enabled. In between, only the neighborhoods of existing tracks are scanned, at each track's scale and the
+ * scales on either side. The grayscale and integral image buffers are kept from frame to frame
+ * @param  {Unsigned char*}                  inputBuf Pointer to an HTML5 ImageData buffer
+ * @param  {Float}                           minsd    Minimum subwindow standard deviation (0 disables)
+ * @return {std::vector<std::array<int, 3>>}          Bounding boxes of the detections found in this frame, valid until the next call
+ */
+std::vector<std::array<int, 3>>& Tracker::detect(unsigned char inputBuf[], float minsd) {
+	if (this->source->revision != this->revision) {
+		this->scales = this->source->pyramid(this->step, this->w, this->h);
+		this->revision = this->source->revision;
+	}
+
+	toGrayscaleFloat(inputBuf, this->w, this->h, this->gray.data());
+	this->integral.compute(this->gray.data(), this->w, this->h, false, this->sumTable);
+	this->integralSquared.compute(this->gray.data(), this->w, this->h, true, this->sumTable);
+	IntegralImage& integral = this->integral;
+	IntegralImage& integralSquared = this->integralSquared;
+	WindowStats& stats = this->stats;
+	std::vector<std::array<int, 3>>& roi = this->roi;
+	roi.clear();
+
+	bool scheduled = this->frame % this->interval == 0;
+	bool refresh = !this->gate || this->frame >= this->nextRefresh;
+	if (this->gate) this->movedBlocks = this->gate->update(integral, integralSquared);
+
+	if (scheduled && refresh) {
+		for (int i = 0; i < this->scales.size(); i += 1) {
+			int s = this->scales[i].baseResolution;
+			sweep(integral, integralSquared, stats, this->scales[i], 0, 0, this->w - s, this->h - s, this->stride, minsd, roi);
+		}
+		if (this->gate) {
+			this->gate->clear();
+			this->nextRefresh = this->frame + this->refresh;
+		}
+	} else {
+		if (scheduled) {
+			for (int i = 0; i < this->scales.size(); i += 1) {
+				this->gate->sweep(integral, integralSquared, stats, this->scales[i], this->stride, minsd, roi);
+			}
+			this->gate->clear();
+		}
+
+		for (int i = 0; i < this->tracks.size(); i += 1) {
+			sweepNeighborhood(integral, integralSquared, stats, this->scales, this->tracks[i].box, 
+			                  this->w, this->h, this->stride, minsd, roi);
+		}
+
+		// Neighborhoods of nearby tracks overlap each other and the moved blocks
+		std::sort(roi.begin(), roi.end());
+		roi.erase(std::unique(roi.begin(), roi.end()), roi.end());
+	}
+	this->frame += 1;
+	return roi;
+}
+
+/**
+ * Associate a frame's detections with existing tracks
+ * Each detection extends the unmatched track it overlaps most, or starts a new track if it overlaps none.
+ * Tracks that go unmatched for more than maxMisses frames are dropped. The bookkeeping is kept from frame to frame
+ * @param {std::vector<std::array<int, 3>>} boxes The frame's detections, after post processing
+ */
+void Tracker::update(std::vector<std::array<int, 3>>& boxes) {
+	std::vector<bool>& matched = this->matched;
+	std::vector<Track>& born = this->born;
+	matched.assign(this->tracks.size(), false);
+	born.clear();
+	for (int i = 0; i < boxes.size(); i += 1) {
+		int best = -1;
+		float bestOverlap = 0.3f;
+		for (int j = 0; j < this->tracks.size(); j += 1) {
+			if (matched[j]) continue;
+			float overlap = iou(boxes[i], this->tracks[j].box);
+			if (overlap > bestOverlap) {
+				bestOverlap = overlap;
+				best = j;
+			}
+		}
+
+		if (best >= 0) {
+			matched[best] = true;
+			this->tracks[best].box = boxes[i];
+			this->tracks[best].age += 1;
+			this->tracks[best].misses = 0;
+		} else {
+			born.push_back({this->nextId, boxes[i], 1, 0});
+			this->nextId += 1;
+		}
+	}
+
+	for (int i = this->tracks.size() - 1; i >= 0; i -= 1) {
+		if (matched[i]) continue;
+		this->tracks[i].misses += 1;
+		if (this->tracks[i].misses > this->maxMisses) this->tracks.erase(this->tracks.begin() + i);
+	}
+	this->tracks.insert(this->tracks.end(), born.begin(), born.end());
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <array>
+
+#include "cascade-classifier.h"
+#include "integral-image.h"
+#include "window-stats.h"
+#include "motion-gate.h"
+#include "post-processor.h"
+
+struct Track {
+	int id;
+	std::array<int, 3> box;
+	int age;
+	int misses;
+};
+
+class Tracker {
+	public:
+		Tracker(CascadeClassifier& cc, int w, int h, float step, float delta, int interval);
+		~Tracker();
+		void setMotionGate(int blockSize, float thresh, int refresh);
+		std::vector<std::array<int, 3>>& detect(unsigned char inputBuf[], float minsd);
+		void update(std::vector<std::array<int, 3>>& boxes);
+		int w;
+		int h;
+		int stride;
+		float step;
+		int revision;
+		CascadeClassifier* source;
+		int interval;
+		int maxMisses;
+		int frame;
+		int nextId;
+		int refresh;
+		int nextRefresh;
+		int movedBlocks;
+		MotionGate* gate;
+		std::vector<CascadeClassifier> scales;
+		std::vector<Track> tracks;
+		std::vector<float> gray;
+		std::vector<float> sumTable;
+		IntegralImage integral;
+		IntegralImage integralSquared;
+		WindowStats stats;
+		std::vector<std::array<int, 3>> roi;
+		std::vector<bool> matched;
+		std::vector<Track> born;
+		PostProcessor post;
+};
@@ -1,15 +1,17 @@
 #include <vector>
+#include <array>
 #include <cmath>
 
 #include "utility.h"
 
 /**
  * Convert an HTML5 ImageData offset to a 2D vector
- * @param {Int} offset The offset
- * @param {Int} w      Width of the ImageData object
+ * @param  {Int}                offset The offset
+ * @param  {Int}                w      Width of the ImageData object
+ * @return {std::array<int, 2>}        The 2D vector [x, y]
  */
-std::vector<int> offsetToVec2(int offset, int w) {
-	std::vector<int> vec2(2);
+std::array<int, 2> offsetToVec2(int offset, int w) {
+	std::array<int, 2> vec2;
 	int pixelOffset = offset / 4;
 	vec2[0] = pixelOffset % w;
 	vec2[1] = pixelOffset / w;
@@ -55,8 +57,20 @@ unsigned char* toGrayscale(unsigned char inputBuf[], int w, int h) {
  * @return {Unsigned char*}          Pointer to a new buffer
  */
 float* toGrayscaleFloat(unsigned char inputBuf[], int w, int h) {
+	float* gs = new float[w * h * 4];
+	return toGrayscaleFloat(inputBuf, w, h, gs);
+}
+
+/**
+ * Convert an HTML5 ImageData buffer to floating point pseudograyscale format in a buffer provided by the caller
+ * @param  {Unsigned char*} inputBuf Pointer to an ImageData buffer
+ * @param  {Int}            w        Width of ImageData object
+ * @param  {Int}            h        Height of ImageData object
+ * @param  {Float*}         gs       Pointer to the output buffer, at least w * h * 4 floats long
+ * @return {Float*}                  Pointer to the output buffer
+ */
+float* toGrayscaleFloat(unsigned char inputBuf[], int w, int h, float gs[]) {
 	int size = w * h * 4;
-	float* gs = new float[size];
 	for (int i = 0; i < size; i += 4) {
 		float r = float(inputBuf[i]) * 0.2126f;
 		float g = float(inputBuf[i + 1]) * 0.7152f;
@@ -70,6 +84,25 @@ float* toGrayscaleFloat(unsigned char inputBuf[], int w, int h) {
 	return gs;
 }
 
+/**
+ * Convert a luma plane to floating point pseudograyscale format in a buffer provided by the caller
+ * @param  {Unsigned char*} luma Pointer to the luma plane, one byte per pixel
+ * @param  {Int}            w    Width of the plane
+ * @param  {Int}            h    Height of the plane
+ * @param  {Float*}         gs   Pointer to the output buffer, at least w * h * 4 floats long
+ * @return {Float*}              Pointer to the output buffer
+ */
+float* lumaToGrayscaleFloat(const unsigned char luma[], int w, int h, float gs[]) {
+	int size = w * h;
+	for (int i = 0, j = 0; i < size; i += 1, j += 4) {
+		gs[j] = 0;
+		gs[j + 1] = 0;
+		gs[j + 2] = 0;
+		gs[j + 3] = 255.0f - float(luma[i]);
+	}
+	return gs;
+}
+
 /**
  * Apply variance normalization to a pseudograyscale HTML5 ImageData buffer 
  * @param  {Unsigned char*} inputBuf Pointer to an ImageData buffer
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <vector>
+#include <array>
 
-std::vector<int> offsetToVec2(int offset, int w);
+std::array<int, 2> offsetToVec2(int offset, int w);
 unsigned char rgbToLuma(unsigned char r, unsigned char g, unsigned char b);
 unsigned char* toGrayscale(unsigned char inputBuf[], int w, int h);
 float* toGrayscaleFloat(unsigned char inputBuf[], int w, int h);
+float* toGrayscaleFloat(unsigned char inputBuf[], int w, int h, float gs[]);
+float* lumaToGrayscaleFloat(const unsigned char luma[], int w, int h, float gs[]);
 float* imageDataToNormalizedBuffer(unsigned char inputBuf[], int w, int h);
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <csignal>
+#include <unistd.h>
+
+#define cimg_display 0
+#include "../../lib/CImg.h"
+
+#include "detection-protocol.h"
+#include "utility.h"
+
+/**
+ * Read an image file into a luma plane
+ * Images are read with CImg, which reads PNM files itself and other formats through ImageMagick if installed
+ * @param  {Char*}                      path Path to the image file
+ * @param  {std::vector<unsigned char>} luma Where to store the luma plane
+ * @param  {Int}                        w    Where to store the width of the image
+ * @param  {Int}                        h    Where to store the height of the image
+ * @return {Bool}                            True if the image was read
+ */
+static bool loadLuma(const char path[], std::vector<unsigned char>& luma, int& w, int& h) {
+	cimg_library::cimg::exception_mode(0);
+	cimg_library::CImg<unsigned char> image;
+	try {
+		image.load(path);
+	} catch (cimg_library::CImgException&) {
+		return false;
+	}
+	w = image.width();
+	h = image.height();
+	luma.resize(w * h);
+	bool color = image.spectrum() >= 3;
+	for (int y = 0; y < h; y += 1) {
+		for (int x = 0; x < w; x += 1) {
+			luma[y * w + x] = color ? rgbToLuma(image(x, y, 0, 0), image(x, y, 0, 1), image(x, y, 0, 2)) : image(x, y, 0, 0);
+		}
+	}
+	return true;
+}
+
+/**
+ * Read a response from a detection server
+ * @param  {Int}              fd      The connected socket
+ * @param  {ResponseHeader}   header  Where to store the response header
+ * @param  {std::vector<int>} records Where to store the detection records, seven elements each
+ * @return {Bool}                     True if a whole, well formed response was read
+ */
+static bool readResponse(int fd, ResponseHeader& header, std::vector<int>& records) {
+	if (!readFully(fd, &header, sizeof(header)) || header.magic != RESPONSE_MAGIC) return false;
+	records.resize(header.status == STATUS_OK ? header.count * 7 : 0);
+	return readFully(fd, records.data(), records.size() * sizeof(int));
+}
+
+/**
+ * Describe a response status
+ * @param  {Int}   status The status
+ * @return {Char*}        The description
+ */
+static const char* describeStatus(int status) {
+	if (status == STATUS_MALFORMED) return "malformed request";
+	if (status == STATUS_UNKNOWN_MODEL) return "unknown model";
+	if (status == STATUS_BAD_SIZE) return "frame too small or too large";
+	return "unknown status";
+}
+
+/**
+ * Print the usage of wasmface-client
+ */
+static void printUsage() {
+	std::printf("\nUsage: wasmface-client --s <socket> [options] <image>\n"
+	            "  --model    Index of the server's model to detect with (default 0)\n"
+	            "  --step     Detector scale step (default 2)\n"
+	            "  --delta    Detector sweep delta (default 2)\n"
+	            "  --pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping (default 1)\n"
+	            "  --othresh  Overlap threshold for post processing (default 0.3)\n"
+	            "  --nthresh  Neighbor threshold for post processing (default 10)\n"
+	            "  --minsd    Minimum subwindow standard deviation (default 0, disabled)\n"
+	            "  --mindepth Minimum number of stages passed to report a subwindow (default 0, positive detections only)\n"
+	            "\n       wasmface-client --s <socket> --load <connections> [--n <requests>] [--q <in flight>] [options] <image>\n"
+	            "  Send n requests for the image on each connection, keeping q in flight (defaults 100 and 1), then print\n"
+	            "  the throughput and latencies seen by the client and the server's counters\n"
+	            "\n       wasmface-client --s <socket> --stats\n"
+	            "  Print the server's counters\n");
+}
+
+/**
+ * Print a detection server's counters
+ * @param {ServerStats} stats The counters
+ */
+static void printStats(ServerStats& stats) {
+	std::printf("server: %u connections, %u requests in %.1f s, %u answered, %u failed, %.1f requests/s\n",
+	            stats.connections, stats.requests, stats.uptime, stats.completed, stats.failed, stats.throughput);
+	std::printf("  %u batches on %u workers, %.2f requests per batch\n", stats.batches, stats.workers, stats.meanBatch);
+	std::printf("  queue mean %.2f ms, max %.2f ms; detect mean %.2f ms, max %.2f ms\n", stats.meanQueue, stats.maxQueue,
+	            stats.meanDetect, stats.maxDetect);
+	std::printf("  latency p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", stats.p50Latency, stats.p99Latency, stats.maxLatency);
+}
+
+/**
+ * Fetch and print a detection server's counters
+ * @param  {Char*} path Path of the server's socket
+ * @return {Bool}       True if the counters were fetched
+ */
+static bool fetchStats(const char path[]) {
+	int fd = connectToServer(path);
+	if (fd < 0) return false;
+	RequestHeader request;
+	std::memset(&request, 0, sizeof(request));
+	request.magic = REQUEST_MAGIC;
+	request.version = PROTOCOL_VERSION;
+	request.type = REQUEST_STATS;
+	ResponseHeader header;
+	ServerStats stats;
+	bool ok = writeFully(fd, &request, sizeof(request)) && readFully(fd, &header, sizeof(header)) &&
+	          header.magic == RESPONSE_MAGIC && header.status == STATUS_OK && readFully(fd, &stats, sizeof(stats));
+	close(fd);
+	if (ok) printStats(stats);
+	return ok;
+}
+
+/**
+ * Load generator connection thread
+ * Sends requests for the same frame, keeping up to inFlight unanswered, and records each request's latency
+ * @param {Char*}                      path      Path of the server's socket
+ * @param {RequestHeader}              request   The request header, whose id is set per request
+ * @param {std::vector<unsigned char>} luma      The luma plane
+ * @param {Int}                        n         Number of requests to send
+ * @param {Int}                        inFlight  Most requests to have unanswered at once
+ * @param {std::vector<double>}        latencies Where to store each request's latency in milliseconds
+ * @param {Int}                        failed    Where to store the number of requests that went unanswered or failed
+ */
+static void generateLoad(const char path[], RequestHeader request, std::vector<unsigned char>& luma, int n, int inFlight,
+                         std::vector<double>& latencies, int& failed) {
+	failed = n;
+	int fd = connectToServer(path);
+	if (fd < 0) return;
+	std::vector<std::chrono::steady_clock::time_point> sent(n);
+	std::vector<int> records;
+	ResponseHeader header;
+	int next = 0;
+	int answered = 0;
+	failed = 0;
+	bool writable = true;
+	while (answered < n) {
+		// A request whose writing fails may still have been answered, as when the server rejects it and hangs up, so
+		// the answers to every request sent so far are read before giving up
+		while (writable && next < n && next - answered < inFlight) {
+			request.id = next;
+			sent[next] = std::chrono::steady_clock::now();
+			writable = writeFully(fd, &request, sizeof(request)) && writeFully(fd, luma.data(), luma.size());
+			next += 1;
+		}
+		if (next == answered || !readResponse(fd, header, records) || header.id >= n) break;
+		latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sent[header.id]).count());
+		failed += header.status != STATUS_OK;
+		answered += 1;
+	}
+	failed += n - answered;
+	close(fd);
+}
+
+/**
+ * Send detection requests to a detection server and print the detections, or generate load and print latencies
+ * @param  {Int}   argc
+ * @param  {Char*} argv
+ * @return {Int}
+ */
+int main(int argc, char* argv[]) {
+	char* pathToSocket = nullptr;
+	char* pathToImage = nullptr;
+	bool statsOnly = false;
+	int connections = 0;
+	int n = 100;
+	int inFlight = 1;
+	RequestHeader request;
+	std::memset(&request, 0, sizeof(request));
+	request.magic = REQUEST_MAGIC;
+	request.version = PROTOCOL_VERSION;
+	request.type = REQUEST_DETECT;
+	request.step = 2;
+	request.delta = 2;
+	request.pp = 1;
+	request.othresh = 0.3;
+	request.nthresh = 10;
+	for (int i = 1; i < argc; i += 1) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--s") == 0 && hasValue) {
+			pathToSocket = argv[++i];
+		} else if (std::strcmp(argv[i], "--model") == 0 && hasValue) {
+			request.model = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--step") == 0 && hasValue) {
+			request.step = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--delta") == 0 && hasValue) {
+			request.delta = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--pp") == 0 && hasValue) {
+			request.pp = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--othresh") == 0 && hasValue) {
+			request.othresh = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--nthresh") == 0 && hasValue) {
+			request.nthresh = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--minsd") == 0 && hasValue) {
+			request.minsd = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--mindepth") == 0 && hasValue) {
+			request.mindepth = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--load") == 0 && hasValue) {
+			connections = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--n") == 0 && hasValue) {
+			n = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--q") == 0 && hasValue) {
+			inFlight = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--stats") == 0) {
+			statsOnly = true;
+		} else if (argv[i][0] == '-' && argv[i][1] == '-') {
+			std::printf("\nError: unknown argument '%s'\n", argv[i]);
+			printUsage();
+			return 1;
+		} else {
+			pathToImage = argv[i];
+		}
+	}
+	if (!pathToSocket || (!statsOnly && !pathToImage)) {
+		printUsage();
+		return 1;
+	}
+	std::signal(SIGPIPE, SIG_IGN);
+
+	if (statsOnly) {
+		if (fetchStats(pathToSocket)) return 0;
+		std::printf("\nError: can't get counters from '%s'\n", pathToSocket);
+		return 1;
+	}
+
+	std::vector<unsigned char> luma;
+	int w;
+	int h;
+	if (!loadLuma(pathToImage, luma, w, h)) {
+		std::printf("\n%s: can't read image\n", pathToImage);
+		return 1;
+	}
+	request.width = w;
+	request.height = h;
+
+	if (connections) {
+		std::vector<std::vector<double>> latencies(connections);
+		std::vector<int> failed(connections);
+		std::vector<std::thread> threads;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < connections; i += 1) {
+			threads.emplace_back(generateLoad, pathToSocket, request, std::ref(luma), n, inFlight, std::ref(latencies[i]),
+			                     std::ref(failed[i]));
+		}
+		for (int i = 0; i < connections; i += 1) threads[i].join();
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::vector<double> all;
+		int failures = 0;
+		for (int i = 0; i < connections; i += 1) {
+			all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+			failures += failed[i];
+		}
+		std::sort(all.begin(), all.end());
+		std::printf("%s: %dx%d, %d connections x %d requests, %d in flight each\n", pathToImage, w, h, connections, n,
+		            inFlight);
+		std::printf("client: %d answered, %d failed in %.2f s, %.1f requests/s\n", int(all.size()), failures, elapsed,
+		            all.size() / elapsed);
+		if (!all.empty()) {
+			std::printf("  latency p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", all[all.size() / 2],
+			            all[std::min(all.size() - 1, all.size() * 99 / 100)], all.back());
+		}
+		fetchStats(pathToSocket);
+		return failures ? 1 : 0;
+	}
+
+	int fd = connectToServer(pathToSocket);
+	if (fd < 0) {
+		std::printf("\nError: can't connect to '%s'\n", pathToSocket);
+		return 1;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	ResponseHeader header;
+	std::vector<int> records;
+
+	// The server may answer a request it rejects and hang up before the frame is written, so the answer is read even
+	// if writing fails
+	if (writeFully(fd, &request, sizeof(request))) writeFully(fd, luma.data(), luma.size());
+	bool ok = readResponse(fd, header, records);
+	double roundTrip = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	close(fd);
+	if (!ok) {
+		std::printf("\nError: no answer from '%s'\n", pathToSocket);
+		return 1;
+	}
+	if (header.status != STATUS_OK) {
+		std::printf("\n%s: %s\n", pathToImage, describeStatus(header.status));
+		return 1;
+	}
+
+	std::printf("%s: %dx%d, %u detections\n", pathToImage, w, h, header.count);
+	if (header.count) std::printf("  %6s %6s %6s %6s %10s %9s\n", "x", "y", "s", "depth", "margin", "neighbors");
+	for (int i = 0; i < header.count; i += 1) {
+		int* record = &records[i * 7];
+		float margin;
+		std::memcpy(&margin, &record[4], sizeof(margin));
+		std::printf("  %6d %6d %6d %6d %10.4f %9d\n", record[0], record[1], record[2], record[3], margin, record[5]);
+	}
+	std::printf("  round trip %.2f ms, queued %.2f ms, detect %.2f ms\n", roundTrip, header.queueTime, header.detectTime);
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "cascade-classifier.h"
+#include "model-json.h"
+#include "model-format.h"
+
+/**
+ * Convert a JSON model to the binary model format
+ * Accepts the .js models written by wasmface-trainer, such as models/human-face.js, as well as plain JSON
+ * Usage: wasmface-convert <input .js or .json> <output .wfm>
+ * @return {Int}
+ */
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::cout << "\nUsage: wasmface-convert <input .js or .json> <output .wfm>\n";
+		return 1;
+	}
+
+	std::ifstream inputFile(argv[1]);
+	if (!inputFile) {
+		std::cout << "\nError: can't read '" << argv[1] << "'\n";
+		return 1;
+	}
+	std::stringstream buffer;
+	buffer << inputFile.rdbuf();
+	std::string text = buffer.str();
+
+	// Skip the variable declaration around the JSON object in .js models
+	std::size_t first = text.find('{');
+	std::size_t last = text.rfind('}');
+	if (first == std::string::npos || last == std::string::npos) {
+		std::cout << "\nError: no JSON object in '" << argv[1] << "'\n";
+		return 1;
+	}
+	std::string json = text.substr(first, last - first + 1);
+
+	float fpr = 0;
+	float fnr = 0;
+	CascadeClassifier* cc = cascadeFromJSON(json.c_str(), &fpr, &fnr);
+	if (!cc) {
+		std::cout << "\nError: '" << argv[1] << "' is not a well formed model\n";
+		return 1;
+	}
+	std::string bytes = cascadeToBinary(*cc, fpr, fnr);
+
+	std::ofstream outputFile(argv[2], std::ios_base::binary | std::ios_base::trunc);
+	outputFile.write(bytes.data(), bytes.size());
+	outputFile.close();
+
+	int features = 0;
+	for (int i = 0; i < cc->strongClassifiers.size(); i += 1) features += cc->strongClassifiers[i].weakClassifiers.size();
+	std::cout << "Converted " << cc->strongClassifiers.size() << " layers and " << features << " features: " 
+	          << text.size() << " bytes --> " << bytes.size() << " bytes\n";
+	delete cc;
+	return 0;
+}
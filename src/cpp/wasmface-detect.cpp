@@ -0,0 +1,204 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+
+#define cimg_display 0
+#include "../../lib/CImg.h"
+
+#include "wasmface.h"
+
+/**
+ * Load a model through the C API, in the binary model format or, unless the library is slim, as JSON
+ * Accepts the .js models written by wasmface-trainer as well as plain JSON
+ * @param  {Char*}              path Path to the model file
+ * @return {CascadeClassifier*}      A pointer to a new cascade classifier object, or null if the model can't be read
+ */
+static CascadeClassifier* loadModel(char path[]) {
+	CascadeClassifier* cc = createFromFile(path);
+#ifndef WASMFACE_SLIM
+	if (cc) return cc;
+	std::ifstream file(path);
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	std::string text = buffer.str();
+	std::size_t first = text.find('{');
+	std::size_t last = text.rfind('}');
+	if (first == std::string::npos || last == std::string::npos || last < first) return nullptr;
+	std::string json = text.substr(first, last - first + 1);
+	cc = create(&json[0]);
+#endif
+	return cc;
+}
+
+/**
+ * Convert a CImg object to an HTML5 ImageData buffer, opaque, with grayscale images repeated across RGB
+ * Assumes the color space of the input object is RGB or grayscale
+ * @param  {cimg_library::CImg<unsigned char>} image The CImg object
+ * @param  {std::vector<unsigned char>}        rgba  Where to store the buffer
+ */
+static void cimgToImageData(cimg_library::CImg<unsigned char>& image, std::vector<unsigned char>& rgba) {
+	rgba.resize(image.width() * image.height() * 4);
+	int channels = image.spectrum() >= 3 ? 3 : 1;
+	for (int y = 0; y < image.height(); y += 1) {
+		for (int x = 0; x < image.width(); x += 1) {
+			unsigned char* pixel = &rgba[(y * image.width() + x) * 4];
+			for (int c = 0; c < 3; c += 1) pixel[c] = image(x, y, 0, channels == 3 ? c : 0);
+			pixel[3] = 255;
+		}
+	}
+}
+
+/**
+ * Print the usage of wasmface-detect
+ */
+static void printUsage() {
+	std::printf("\nUsage: wasmface-detect --m <model .wfm, .js or .json> [options] <image> [<image> ...]\n"
+	            "  --step     Detector scale step (default 2)\n"
+	            "  --delta    Detector sweep delta (default 2)\n"
+	            "  --pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping (default 1)\n"
+	            "  --othresh  Overlap threshold for post processing (default 0.3)\n"
+	            "  --nthresh  Neighbor threshold for post processing (default 10)\n"
+	            "  --minsd    Minimum subwindow standard deviation (default 0, disabled)\n"
+	            "  --mindepth Minimum number of stages passed to report a subwindow (default 0, positive detections only)\n"
+	            "  --r        Number of times to detect in each image, timings are averaged (default 1)\n");
+#ifdef WASMFACE_COUNT_ALLOCS
+	std::printf("\n       wasmface-detect --check-allocs\n"
+	            "  Check that steady-state detection makes no heap allocations\n");
+#endif
+}
+
+/**
+ * Detect objects in image files and print the detections and the time spent in each phase
+ * Images are read with CImg, which reads PNM files itself and other formats through ImageMagick if installed.
+ * Each image is detected in a detector session that is kept while the image size stays the same, as a server would
+ * @param  {Int}   argc
+ * @param  {Char*} argv
+ * @return {Int}
+ */
+int main(int argc, char* argv[]) {
+	char* pathToModel = nullptr;
+	float step = 2;
+	float delta = 2;
+	int pp = 1;
+	float othresh = 0.3;
+	int nthresh = 10;
+	float minsd = 0;
+	int mindepth = 0;
+	int repeat = 1;
+	std::vector<char*> pathsToImages;
+	for (int i = 1; i < argc; i += 1) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--m") == 0 && hasValue) {
+			pathToModel = argv[++i];
+		} else if (std::strcmp(argv[i], "--step") == 0 && hasValue) {
+			step = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--delta") == 0 && hasValue) {
+			delta = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--pp") == 0 && hasValue) {
+			pp = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--othresh") == 0 && hasValue) {
+			othresh = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--nthresh") == 0 && hasValue) {
+			nthresh = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--minsd") == 0 && hasValue) {
+			minsd = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--mindepth") == 0 && hasValue) {
+			mindepth = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--r") == 0 && hasValue) {
+			repeat = std::max(1, std::atoi(argv[++i]));
+#ifdef WASMFACE_COUNT_ALLOCS
+		} else if (std::strcmp(argv[i], "--check-allocs") == 0) {
+			return checkZeroAllocs();
+#endif
+		} else if (argv[i][0] == '-' && argv[i][1] == '-') {
+			std::printf("\nError: unknown argument '%s'\n", argv[i]);
+			printUsage();
+			return 1;
+		} else {
+			pathsToImages.push_back(argv[i]);
+		}
+	}
+	if (!pathToModel || pathsToImages.empty()) {
+		printUsage();
+		return 1;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	CascadeClassifier* cc = loadModel(pathToModel);
+	if (!cc) {
+		std::printf("\nError: can't load a model from '%s'\n", pathToModel);
+		return 1;
+	}
+	double modelTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::printf("Loaded %d stages from '%s' in %.2f ms\n", getStageCount(cc), pathToModel, modelTime);
+
+	const char* phases[] = {"scales", "grayscale", "integral", "sweep", "post processing"};
+	const int phaseCount = sizeof(phases) / sizeof(phases[0]);
+	Detector* dt = nullptr;
+	int w = 0;
+	int h = 0;
+	int capacity = 64;
+	std::vector<int> out(2 + capacity * 7);
+	std::vector<unsigned char> rgba;
+	int failed = 0;
+	cimg_library::cimg::exception_mode(0);
+	for (int i = 0; i < pathsToImages.size(); i += 1) {
+		start = std::chrono::steady_clock::now();
+		cimg_library::CImg<unsigned char> image;
+		try {
+			image.load(pathsToImages[i]);
+		} catch (cimg_library::CImgException&) {
+			std::printf("\n%s: can't read image\n", pathsToImages[i]);
+			failed = 1;
+			continue;
+		}
+		cimgToImageData(image, rgba);
+		double loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		if (!dt || image.width() != w || image.height() != h) {
+			if (dt) destroyDetector(dt);
+			w = image.width();
+			h = image.height();
+			dt = createDetector(cc, w, h, step, delta);
+		}
+		double setupTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		double times[phaseCount] = {0};
+		double detectTime = 0;
+		int found = 0;
+		for (int r = 0; r < repeat; r += 1) {
+			start = std::chrono::steady_clock::now();
+			found = detectWith(dt, rgba.data(), pp, othresh, nthresh, minsd, mindepth, out.data(), capacity);
+			if (found > capacity) {
+				capacity = found;
+				out.resize(2 + capacity * 7);
+				found = detectWith(dt, rgba.data(), pp, othresh, nthresh, minsd, mindepth, out.data(), capacity);
+			}
+			detectTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			for (int j = 0; j < phaseCount; j += 1) times[j] += getPhaseTime(dt, j);
+		}
+
+		std::printf("\n%s: %dx%d, %d detections\n", pathsToImages[i], w, h, found);
+		if (found) std::printf("  %6s %6s %6s %6s %10s %9s\n", "x", "y", "s", "depth", "margin", "neighbors");
+		for (int j = 0; j < found; j += 1) {
+			int* record = &out[2 + j * 7];
+			float margin;
+			std::memcpy(&margin, &record[4], sizeof(margin));
+			std::printf("  %6d %6d %6d %6d %10.4f %9d\n", record[0], record[1], record[2], record[3], margin, record[5]);
+		}
+		std::printf("  load %.2f ms, session %.2f ms, detect %.2f ms (", loadTime, setupTime, detectTime / repeat);
+		for (int j = 0; j < phaseCount; j += 1) std::printf("%s%s %.2f ms", j ? ", " : "", phases[j], times[j] / repeat);
+		std::printf("), %d subwindows, %d rejected by the variance floor\n", getWindowCount(), getRejectedCount());
+	}
+
+	if (dt) destroyDetector(dt);
+	destroy(cc);
+	return failed;
+}
@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <csignal>
+#include <pthread.h>
+
+#include "detection-server.h"
+#include "detection-protocol.h"
+#include "cascade-classifier.h"
+#include "model-format.h"
+#ifndef WASMFACE_SLIM
+#include "model-json.h"
+#endif
+
+/**
+ * Load a model in the binary model format or, unless the library is slim, as JSON
+ * Accepts the .js models written by wasmface-trainer as well as plain JSON
+ * @param  {Char*}              path Path to the model file
+ * @return {CascadeClassifier*}      A pointer to a new cascade classifier object, or null if the model can't be read
+ */
+static CascadeClassifier* loadModel(const char path[]) {
+	CascadeClassifier* cc = loadBinaryModel(path);
+#ifndef WASMFACE_SLIM
+	if (cc) return cc;
+	std::ifstream file(path);
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	std::string text = buffer.str();
+	std::size_t first = text.find('{');
+	std::size_t last = text.rfind('}');
+	if (first == std::string::npos || last == std::string::npos || last < first) return nullptr;
+	cc = cascadeFromJSON(text.substr(first, last - first + 1).c_str());
+#endif
+	return cc;
+}
+
+/**
+ * Print the usage of wasmface-server
+ */
+static void printUsage() {
+	std::printf("\nUsage: wasmface-server --s <socket> --m <model .wfm, .js or .json> [--m <model> ...] [options]\n"
+	            "  --w        Number of worker threads (default one per hardware thread)\n"
+	            "  --b        Most requests a worker takes from the queue at once (default 8)\n"
+	            "Models are numbered from 0 in the order given. Stop the server with SIGINT or SIGTERM\n");
+}
+
+/**
+ * Print a detection server's counters
+ * @param {ServerStats} stats The counters
+ */
+static void printStats(ServerStats& stats) {
+	std::printf("%u requests in %.1f s, %u answered, %u failed, %.1f requests/s\n", stats.requests, stats.uptime,
+	            stats.completed, stats.failed, stats.throughput);
+	std::printf("%u batches on %u workers, %.2f requests per batch\n", stats.batches, stats.workers, stats.meanBatch);
+	std::printf("queue mean %.2f ms, max %.2f ms; detect mean %.2f ms, max %.2f ms\n", stats.meanQueue, stats.maxQueue,
+	            stats.meanDetect, stats.maxDetect);
+	std::printf("latency p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", stats.p50Latency, stats.p99Latency, stats.maxLatency);
+}
+
+/**
+ * Serve detection requests over a Unix domain socket until interrupted, then print the server's counters
+ * @param  {Int}   argc
+ * @param  {Char*} argv
+ * @return {Int}
+ */
+int main(int argc, char* argv[]) {
+	char* pathToSocket = nullptr;
+	std::vector<char*> pathsToModels;
+	int workers = std::max(1u, std::thread::hardware_concurrency());
+	int batch = 8;
+	for (int i = 1; i < argc; i += 1) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--s") == 0 && hasValue) {
+			pathToSocket = argv[++i];
+		} else if (std::strcmp(argv[i], "--m") == 0 && hasValue) {
+			pathsToModels.push_back(argv[++i]);
+		} else if (std::strcmp(argv[i], "--w") == 0 && hasValue) {
+			workers = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--b") == 0 && hasValue) {
+			batch = std::max(1, std::atoi(argv[++i]));
+		} else {
+			std::printf("\nError: unknown argument '%s'\n", argv[i]);
+			printUsage();
+			return 1;
+		}
+	}
+	if (!pathToSocket || pathsToModels.empty()) {
+		printUsage();
+		return 1;
+	}
+
+	std::vector<CascadeClassifier*> models;
+	for (int i = 0; i < pathsToModels.size(); i += 1) {
+		CascadeClassifier* cc = loadModel(pathsToModels[i]);
+		if (!cc) {
+			std::printf("\nError: can't load a model from '%s'\n", pathsToModels[i]);
+			return 1;
+		}
+		std::printf("Model %d: %d stages from '%s'\n", i, int(cc->strongClassifiers.size()), pathsToModels[i]);
+		models.push_back(cc);
+	}
+
+	// Writes to clients that hung up fail rather than kill the server, and only this thread takes the stop signals
+	std::signal(SIGPIPE, SIG_IGN);
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+	DetectionServer* server = new DetectionServer(models, workers, batch);
+	if (!server->listen(pathToSocket)) {
+		std::printf("\nError: can't listen on '%s'\n", pathToSocket);
+		delete server;
+		return 1;
+	}
+	std::printf("Listening on '%s' with %d workers, batches of up to %d\n", pathToSocket, workers, batch);
+	std::fflush(stdout);
+
+	int signal;
+	sigwait(&signals, &signal);
+	server->stop();
+	ServerStats stats = server->stats();
+	std::printf("\nStopped\n");
+	printStats(stats);
+	delete server;
+	for (int i = 0; i < models.size(); i += 1) delete models[i];
+	return 0;
+}
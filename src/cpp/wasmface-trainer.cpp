@@ -5,6 +5,10 @@
 #include <experimental/filesystem>
 #include <experimental/random>
 #include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstring>
+#include <cmath>
 
 #include "../../lib/CImg.h"
 #include "../../lib/json.hpp"
@@ -14,6 +18,9 @@
 #include "integral-image.h"
 #include "weak-classifier.h"
 #include "strong-classifier.h"
+#include "alloc-counter.h"
+#include "model-format.h"
+#include "model-json.h"
 
 /**
  * Recursively scan a local directory for image files and store their paths
@@ -41,7 +48,6 @@ void getImagePaths(const std::experimental::filesystem::path& path, std::vector<
  * @return {std::vector<IntegralImage>}                A set of integral images
  */
 std::vector<IntegralImage> computeIntegrals(std::vector<std::string>& paths, int baseResolution) {
-	int size = baseResolution * baseResolution * 4;
 	std::vector<IntegralImage> finalIntegrals;
 	for (int i = 0; i < paths.size(); i += 1) {
 		std::cout << "computeIntegrals(): creating pre-normalized integral image for local image file " << i + 1 << "/" << paths.size() << std::endl;
@@ -49,7 +55,7 @@ std::vector<IntegralImage> computeIntegrals(std::vector<std::string>& paths, int
 		image.resize(baseResolution, baseResolution);
 		auto inputBuf = cimgToHTMLImageData(image);
 		auto normalized = imageDataToNormalizedBuffer(inputBuf, baseResolution, baseResolution);
-		IntegralImage integral(normalized, baseResolution, baseResolution, size, false);
+		IntegralImage integral(normalized, baseResolution, baseResolution, false);
 		finalIntegrals.push_back(integral);
 	 	delete [] inputBuf;
 	 	delete [] normalized;
@@ -66,7 +72,6 @@ std::vector<IntegralImage> computeIntegrals(std::vector<std::string>& paths, int
  * @return {std::vector<IntegralImage>}                A set of integral images
  */
 std::vector<IntegralImage> computeIntegralsRand(std::vector<std::string>& paths, int baseResolution, int setSize) {
-	int size = baseResolution * baseResolution * 4;
 	std::vector<IntegralImage> finalIntegrals;
 	int count = 0;
 	while (finalIntegrals.size() < setSize) {
@@ -78,7 +83,7 @@ std::vector<IntegralImage> computeIntegralsRand(std::vector<std::string>& paths,
 			image.crop(xCrop, yCrop, xCrop + baseResolution - 1, yCrop + baseResolution - 1);
 			auto inputBuf = cimgToHTMLImageData(image);
 			auto normalized = imageDataToNormalizedBuffer(inputBuf, baseResolution, baseResolution);
-			IntegralImage integral(normalized, baseResolution, baseResolution, size, false);
+			IntegralImage integral(normalized, baseResolution, baseResolution, false);
 			finalIntegrals.push_back(integral);
 			delete [] inputBuf;
 			delete [] normalized;
@@ -95,7 +100,6 @@ std::vector<IntegralImage> computeIntegralsRand(std::vector<std::string>& paths,
  * @return {std::vector<IntegralImage>}                A set of integral images       
  */
 std::vector<IntegralImage> computeIntegralsGrid(std::vector<std::string>& paths, int baseResolution) {
-	int size = baseResolution * baseResolution * 4;
 	std::vector<IntegralImage> finalIntegrals;
 	int count = 0;
 	for (int i = 0; i < paths.size(); i += 1) {
@@ -106,7 +110,7 @@ std::vector<IntegralImage> computeIntegralsGrid(std::vector<std::string>& paths,
 				auto crop = image.get_crop(w, h, w + baseResolution - 1, h + baseResolution - 1);
 				auto inputBuf = cimgToHTMLImageData(crop);
 				auto normalized = imageDataToNormalizedBuffer(inputBuf, baseResolution, baseResolution);
-				IntegralImage integral(normalized, baseResolution, baseResolution, size, false);
+				IntegralImage integral(normalized, baseResolution, baseResolution, false);
 				finalIntegrals.push_back(integral);
 				delete [] inputBuf;
 				delete [] normalized;
@@ -302,6 +306,7 @@ StrongClassifier adaBoost(CascadeClassifier& cascadeClassifier, std::vector<Inte
 	while (currentOverallFPR > targetMaxFPR * lastOverallFPR && strongClassifier.weakClassifiers.size() < maxFeatures) {
 		std::cout << "\nSelecting new WC! Our current FPR is " << currentOverallFPR <<
 			" and we'll stop adding WCs when we hit an FPR of " << targetMaxFPR * lastOverallFPR << std::endl;
+		resetAllocCounters();
 
 		// Normalize the weights
 		float wSum = 0;
@@ -366,10 +371,230 @@ StrongClassifier adaBoost(CascadeClassifier& cascadeClassifier, std::vector<Inte
 		
 		std::cout << "\nSC after optimization produces a cascade classifier with an FPR of " <<
 			currentOverallFPR << " and an FNR of " << currentOverallFNR << std::endl;
+
+		if (countingAllocs()) {
+			std::cout << "This round made " << countedAllocsTotal() << " heap allocations totalling " << 
+				countedBytesTotal() << " bytes\n";
+		}
 	}	
 	return strongClassifier;
 }
 
+/**
+ * Load a cascade classifier from a model file, in the binary model format or as JSON
+ * @param  {std::string}        path Path to a .wfm, .js or .json model
+ * @return {CascadeClassifier*}      A pointer to a new cascade classifier object, or nullptr if the model can't be read
+ */
+CascadeClassifier* loadModelFile(std::string path) {
+	if (path.size() > 4 && path.substr(path.size() - 4) == ".wfm") return loadBinaryModel(path.c_str());
+	std::ifstream modelFile(path);
+	std::stringstream buffer;
+	buffer << modelFile.rdbuf();
+	std::string text = buffer.str();
+	std::size_t first = text.find('{');
+	std::size_t last = text.rfind('}');
+	if (first == std::string::npos || last == std::string::npos) return nullptr;
+	return cascadeFromJSON(text.substr(first, last - first + 1).c_str());
+}
+
+/**
+ * Report the false positive rate, false negative rate and cost of a cascade classifier cut off at each depth
+ * Each validation example is run through the cascade once to find the number of stages it passes, which gives the
+ * rates at every depth. Cost is measured over the negative set, since nearly every subwindow in a scan is negative:
+ * the average number of features evaluated per subwindow, and the time per subwindow of the cut off cascade
+ * @param {CascadeClassifier}          cascadeClassifier     The cascade classifier, with any tuning applied
+ * @param {std::vector<IntegralImage>} positiveValidationSet Set of positive validation examples
+ * @param {std::vector<IntegralImage>} negativeValidationSet Set of negative validation examples
+ */
+void reportDepths(CascadeClassifier& cascadeClassifier, std::vector<IntegralImage>& positiveValidationSet, 
+                  std::vector<IntegralImage>& negativeValidationSet) {
+	int stages = cascadeClassifier.strongClassifiers.size();
+	float margin;
+	std::vector<int> positiveDepths, negativeDepths;
+	for (int i = 0; i < positiveValidationSet.size(); i += 1) {
+		positiveDepths.push_back(cascadeClassifier.evaluate(positiveValidationSet[i], 0, 0, 0, 1, margin));
+	}
+	for (int i = 0; i < negativeValidationSet.size(); i += 1) {
+		negativeDepths.push_back(cascadeClassifier.evaluate(negativeValidationSet[i], 0, 0, 0, 1, margin));
+	}
+
+	// Features in stages 0 through i
+	std::vector<int> featuresThrough(stages);
+	for (int i = 0; i < stages; i += 1) {
+		featuresThrough[i] = (i > 0 ? featuresThrough[i - 1] : 0) + cascadeClassifier.strongClassifiers[i].weakClassifiers.size();
+	}
+
+	std::cout << "\ndepth  features  FPR          FNR          features/window  ns/window\n";
+	for (int depth = 1; depth <= stages; depth += 1) {
+		int falsePositives = 0;
+		int falseNegatives = 0;
+		double evaluated = 0;
+		for (int i = 0; i < positiveDepths.size(); i += 1) falseNegatives += positiveDepths[i] < depth;
+		for (int i = 0; i < negativeDepths.size(); i += 1) {
+			falsePositives += negativeDepths[i] >= depth;
+			evaluated += featuresThrough[std::min(negativeDepths[i], depth - 1)];
+		}
+
+		// Time the cut off cascade over the negative set, repeating until the measurement is long enough to trust
+		CascadeClassifier cutoff = cascadeClassifier;
+		cutoff.strongClassifiers.resize(depth);
+		long long windows = 0;
+		volatile int passed = 0;
+		auto start = std::chrono::steady_clock::now();
+		double elapsed = 0;
+		while (negativeValidationSet.size() && elapsed < 0.05) {
+			for (int i = 0; i < negativeValidationSet.size(); i += 1) {
+				passed = passed + cutoff.evaluate(negativeValidationSet[i], 0, 0, 0, 1, margin);
+			}
+			windows += negativeValidationSet.size();
+			elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		std::printf("%5d  %8d  %-11.6g  %-11.6g  %15.2f  %9.1f\n", depth, featuresThrough[depth - 1], 
+		            negativeDepths.size() ? double(falsePositives) / negativeDepths.size() : 0.0,
+		            positiveDepths.size() ? double(falseNegatives) / positiveDepths.size() : 0.0,
+		            negativeDepths.size() ? evaluated / negativeDepths.size() : 0.0, 
+		            windows ? elapsed * 1e9 / windows : 0.0);
+	}
+}
+
+/**
+ * Count the weak classifiers in a cascade classifier
+ * @param  {CascadeClassifier} cascadeClassifier The cascade classifier
+ * @return {Int}                                 Number of weak classifiers across all stages
+ */
+int countFeatures(CascadeClassifier& cascadeClassifier) {
+	int count = 0;
+	for (int i = 0; i < cascadeClassifier.strongClassifiers.size(); i += 1) {
+		count += cascadeClassifier.strongClassifiers[i].weakClassifiers.size();
+	}
+	return count;
+}
+
+/**
+ * Get the average number of features a cascade classifier evaluates per subwindow
+ * @param  {CascadeClassifier}          cascadeClassifier     The cascade classifier
+ * @param  {std::vector<IntegralImage>} negativeValidationSet Set of negative validation examples, standing in for a scan
+ * @return {Float}                                            Average features evaluated per subwindow
+ */
+float averageFeatures(CascadeClassifier& cascadeClassifier, std::vector<IntegralImage>& negativeValidationSet) {
+	double evaluated = 0;
+	float margin;
+	for (int i = 0; i < negativeValidationSet.size(); i += 1) {
+		int depth = cascadeClassifier.evaluate(negativeValidationSet[i], 0, 0, 0, 1, margin);
+		for (int j = 0; j <= depth && j < cascadeClassifier.strongClassifiers.size(); j += 1) {
+			evaluated += cascadeClassifier.strongClassifiers[j].weakClassifiers.size();
+		}
+	}
+	return negativeValidationSet.size() ? evaluated / negativeValidationSet.size() : 0;
+}
+
+/**
+ * Destructively prune and compress each stage of a cascade classifier
+ * Weak classifiers that repeat the feature, threshold and polarity of another in the same stage always cast the same
+ * vote, so they are merged into one with the summed weight. Then, lightest first, each weak classifier whose weight is
+ * below a fraction of the largest weight in its stage is tried without. The stage's threshold is reoptimized as in
+ * training to hold its false negative rate, and the removal is kept only if the stage passes no more of the negative
+ * validation examples that reach it than before. A weaker stage needs a lower threshold to hold its false negative rate,
+ * and passing more subwindows on to later stages would make a scan slower and less precise. Stages that no negative
+ * validation example reaches are left as they are, since there is nothing to measure them against
+ * @param {CascadeClassifier}          cascadeClassifier     The cascade classifier
+ * @param {Float}                      minWeight             Fraction of the largest weight in a stage below which weak classifiers are tried without
+ * @param {std::vector<IntegralImage>} positiveValidationSet Set of positive validation examples
+ * @param {std::vector<IntegralImage>} negativeValidationSet Set of negative validation examples
+ * @param {Float}                      targetFNR             Target max false negative rate per stage, or less than 0 to hold each stage's own
+ */
+void pruneCascade(CascadeClassifier& cascadeClassifier, float minWeight, std::vector<IntegralImage>& positiveValidationSet, 
+                  std::vector<IntegralImage>& negativeValidationSet, float targetFNR) {
+	float margin;
+	for (int i = 0; i < cascadeClassifier.strongClassifiers.size(); i += 1) {
+		StrongClassifier& sc = cascadeClassifier.strongClassifiers[i];
+		float oldThreshold = sc.threshold;
+		int before = sc.weakClassifiers.size();
+
+		// Half an example above the stage's misses, so that optimizeThreshold's index can't round down below them
+		float stageFNR = targetFNR;
+		if (targetFNR < 0) {
+			int misses = std::round(sc.getFNR(positiveValidationSet) * positiveValidationSet.size());
+			stageFNR = (misses + 0.5f) / positiveValidationSet.size();
+		}
+
+		StrongClassifier compressed;
+		compressed.threshold = sc.threshold;
+		for (int j = 0; j < sc.weakClassifiers.size(); j += 1) {
+			WeakClassifier& wc = sc.weakClassifiers[j];
+			int k = 0;
+			for (; k < compressed.weakClassifiers.size(); k += 1) {
+				WeakClassifier& other = compressed.weakClassifiers[k];
+				if (other.haarlike.type == wc.haarlike.type && other.haarlike.x == wc.haarlike.x && 
+				    other.haarlike.y == wc.haarlike.y && other.haarlike.w == wc.haarlike.w && other.haarlike.h == wc.haarlike.h &&
+				    other.threshold == wc.threshold && other.polarity == wc.polarity) break;
+			}
+			if (k < compressed.weakClassifiers.size()) compressed.weights[k] += sc.weights[j];
+			else compressed.add(wc, sc.weights[j]);
+		}
+		int merged = sc.weakClassifiers.size() - compressed.weakClassifiers.size();
+		sc = compressed;
+
+		// Negative validation examples that pass the stages before this one
+		std::vector<IntegralImage> reaching;
+		for (int j = 0; j < negativeValidationSet.size(); j += 1) {
+			if (cascadeClassifier.evaluate(negativeValidationSet[j], 0, 0, 0, 1, margin) >= i) reaching.push_back(negativeValidationSet[j]);
+		}
+		float fpr = sc.getFPR(reaching);
+
+		// Candidates for removal, lightest first
+		float maxWeight = *std::max_element(sc.weights.begin(), sc.weights.end());
+		std::vector<int> candidates;
+		for (int j = 0; j < sc.weights.size(); j += 1) {
+			if (sc.weights[j] < minWeight * maxWeight) candidates.push_back(j);
+		}
+		std::sort(candidates.begin(), candidates.end(), [&sc](int a, int b) { return sc.weights[a] < sc.weights[b]; });
+
+		int pruned = 0;
+		for (int j = 0; j < candidates.size() && sc.weakClassifiers.size() > 1 && reaching.size(); j += 1) {
+			StrongClassifier kept = sc;
+			sc.weakClassifiers.erase(sc.weakClassifiers.begin() + candidates[j]);
+			sc.weights.erase(sc.weights.begin() + candidates[j]);
+			sc.optimizeThreshold(positiveValidationSet, stageFNR);
+			if (sc.getFPR(reaching) > fpr) {
+				sc = kept;
+				continue;
+			}
+			pruned += 1;
+			for (int k = j + 1; k < candidates.size(); k += 1) {
+				if (candidates[k] > candidates[j]) candidates[k] -= 1;
+			}
+		}
+
+		std::cout << "stage " << i + 1 << ": " << before << " -> " << sc.weakClassifiers.size() << " weak classifiers (" << 
+			merged << " merged, " << pruned << " pruned), threshold " << oldThreshold << " -> " << sc.threshold << 
+				", FNR " << sc.getFNR(positiveValidationSet) << ", FPR " << (reaching.size() ? sc.getFPR(reaching) : 0) << " of " << 
+					reaching.size() << " negatives reaching it" << std::endl;
+	}
+}
+
+/**
+ * Write a cascade classifier as a JSON model and in the binary model format
+ * @param {CascadeClassifier} cascadeClassifier The cascade classifier to write
+ * @param {std::string}       path              Path to write to, without an extension
+ * @param {Float}             fpr               False positive rate to include
+ * @param {Float}             fnr               False negative rate to include
+ */
+void saveModel(CascadeClassifier& cascadeClassifier, std::string path, float fpr, float fnr) {
+	std::ofstream modelFile;
+	modelFile.open(path + ".js", std::ios_base::trunc);
+	std::string json = cascadeToJSON(cascadeClassifier, fpr, fnr);
+	modelFile << "const wasmfaceModel = " << json;
+	modelFile.close();
+
+	std::ofstream binaryModelFile;
+	binaryModelFile.open(path + ".wfm", std::ios_base::binary | std::ios_base::trunc);
+	std::string bytes = cascadeToBinary(cascadeClassifier, fpr, fnr);
+	binaryModelFile.write(bytes.data(), bytes.size());
+	binaryModelFile.close();
+}
+
 /**
  * Main function
  * By default we create a 30 layer cascade with sensible targets for FPR and max features per layer
@@ -380,10 +605,6 @@ StrongClassifier adaBoost(CascadeClassifier& cascadeClassifier, std::vector<Inte
  * @return {Int}
  */
 int main(int argc, char* argv[]) {
-	if (argc < 13) {
-		std::cout << "\nError: not enough parameters!\n";
-		return 0;
-	}
 
 	float maxFNRPerLayer = 0.01f; 
 	float targetMaxFPROverall = 0.00001f;
@@ -409,6 +630,12 @@ int main(int argc, char* argv[]) {
 	int baseResolution;
 	int negativeSetSize;
 
+	std::string pathToModel;
+	int maxStages = 0;
+	std::vector<float> offsets;
+	float minWeight = -1;
+	float targetFNR = -1;
+
 	for (int i = 1; i < argc; i += 1) {
 		if (std::strcmp(argv[i], "--p") == 0) {
 			pathToPositives = std::experimental::filesystem::path(argv[i + 1]);
@@ -422,12 +649,78 @@ int main(int argc, char* argv[]) {
 			negativeSetSize = std::atoi(argv[i + 1]);
 		} else if (std::strcmp(argv[i], "--b") == 0) {
 			baseResolution = std::atoi(argv[i + 1]);
+		} else if (std::strcmp(argv[i], "--m") == 0) {
+			pathToModel = argv[i + 1];
+		} else if (std::strcmp(argv[i], "--d") == 0) {
+			maxStages = std::atoi(argv[i + 1]);
+		} else if (std::strcmp(argv[i], "--prune") == 0) {
+			minWeight = std::atof(argv[i + 1]);
+		} else if (std::strcmp(argv[i], "--f") == 0) {
+			targetFNR = std::atof(argv[i + 1]);
+		} else if (std::strcmp(argv[i], "--o") == 0) {
+			std::stringstream list(argv[i + 1]);
+			std::string offset;
+			while (std::getline(list, offset, ',')) offsets.push_back(std::atof(offset.c_str()));
 		} else {
 			std::cout << "\nError: unknown argument '" << argv[i] << "'\n";
 			return 0;
 		}
 		i += 1;
 	}
+
+	// Evaluation mode: report how an existing model performs when cut off at each depth
+	if (!pathToModel.empty()) {
+		CascadeClassifier* model = loadModelFile(pathToModel);
+		if (!model) {
+			std::cout << "\nError: can't read model '" << pathToModel << "'\n";
+			return 0;
+		}
+		model->tune(maxStages, offsets);
+		std::vector<std::string> positivePaths, negativePaths;
+		getImagePaths(pathToValidationPositives, positivePaths);
+		getImagePaths(pathToValidationNegatives, negativePaths);
+		auto positives = computeIntegrals(positivePaths, model->baseResolution);
+		auto negatives = computeIntegralsGrid(negativePaths, model->baseResolution);
+		std::cout << "\nEvaluating '" << pathToModel << "' on " << positives.size() << " positive and " 
+		          << negatives.size() << " negative validation examples\n";
+		if (minWeight < 0) {
+			reportDepths(*model, positives, negatives);
+			delete model;
+			return 0;
+		}
+
+		// Pruning mode: write a smaller model that keeps the per-stage false negative rates of the original
+		if (positives.empty() || negatives.empty()) {
+			std::cout << "\nError: pruning needs positive and negative validation examples\n";
+			delete model;
+			return 0;
+		}
+		int featuresBefore = countFeatures(*model);
+		float costBefore = averageFeatures(*model, negatives);
+		float fprBefore = model->getFPR(negatives);
+		float fnrBefore = model->getFNR(positives);
+		std::cout << "\n";
+		pruneCascade(*model, minWeight, positives, negatives, targetFNR);
+		int featuresAfter = countFeatures(*model);
+		float costAfter = averageFeatures(*model, negatives);
+		float fprAfter = model->getFPR(negatives);
+		float fnrAfter = model->getFNR(positives);
+
+		std::string pathToPruned = pathToModel.substr(0, pathToModel.rfind('.')) + "-pruned";
+		saveModel(*model, pathToPruned, fprAfter, fnrAfter);
+		std::printf("\n          features  features/window  FPR          FNR\n");
+		std::printf("original  %8d  %15.2f  %-11.6g  %-11.6g\n", featuresBefore, costBefore, fprBefore, fnrBefore);
+		std::printf("pruned    %8d  %15.2f  %-11.6g  %-11.6g\n", featuresAfter, costAfter, fprAfter, fnrAfter);
+		std::printf("\nAverage features evaluated per window reduced by %.1f%%. Wrote %s.js and %s.wfm\n", 
+		            costBefore > 0 ? 100 * (1 - costAfter / costBefore) : 0.0, pathToPruned.c_str(), pathToPruned.c_str());
+		delete model;
+		return 0;
+	}
+
+	if (argc < 13) {
+		std::cout << "\nError: not enough parameters!\n";
+		return 0;
+	}
 	
 	std::cout << "\nWasmface\n";
 	std::cout << "Cascade classifier training\n";
@@ -483,12 +776,7 @@ int main(int argc, char* argv[]) {
 		currentOverallFPR = cascadeClassifier.getFPR(negativeValidationSet);
 		currentOverallFNR = cascadeClassifier.getFNR(positiveValidationSet);
 
-		std::ofstream modelFile;
-		std::string filename = "../../models/my-model-" + std::to_string(i + 1) + "-layers.js";
-		modelFile.open(filename, std::ios_base::trunc);
-		std::string json = cascadeToJSON(cascadeClassifier, currentOverallFPR, currentOverallFNR);
-		modelFile << "const wasmfaceModel = " << json;
-		modelFile.close();
+		saveModel(cascadeClassifier, "../../models/my-model-" + std::to_string(i + 1) + "-layers", currentOverallFPR, currentOverallFNR);
 			
 		std::cout << "\n --> Added a new SC with " << sc.weakClassifiers.size() << 
 			" WCs to the CC! Current CC now has " << cascadeClassifier.strongClassifiers.size() << 
@@ -506,7 +794,6 @@ int main(int argc, char* argv[]) {
 		
 		// Crop subwindows from our negative images that cause false positives and add them to our negative
 		// training set until we hit our target negative training set size
-		int size = cascadeClassifier.baseResolution * cascadeClassifier.baseResolution * 4;
 		int stepSize = 1;
 		for (int i = 0; i < negativeExamplePaths.size() && negativeSet.size() < negativeSetSize; i += 1) {
 			std::cout << "Rebuilding negative training set! Checking image " << i + 1 << "/" << negativeExamplePaths.size() << " for suitable subwindows...\n";
@@ -516,7 +803,7 @@ int main(int argc, char* argv[]) {
 					auto crop = image.get_crop(w, h, w + cascadeClassifier.baseResolution - 1, h + cascadeClassifier.baseResolution - 1);
 					auto inputBuf = cimgToHTMLImageData(crop);
 					auto normalized = imageDataToNormalizedBuffer(inputBuf, cascadeClassifier.baseResolution, cascadeClassifier.baseResolution);
-					IntegralImage integral(normalized, cascadeClassifier.baseResolution, cascadeClassifier.baseResolution, size, false);
+					IntegralImage integral(normalized, cascadeClassifier.baseResolution, cascadeClassifier.baseResolution, false);
 					delete [] inputBuf;
 					delete [] normalized;
 					if (cascadeClassifier.classify(integral, 0, 0, 0, 1) == true) {
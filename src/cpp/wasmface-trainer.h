@@ -19,6 +19,14 @@ std::vector<IntegralImage> computeIntegralsGrid(std::vector<std::string>& paths,
 unsigned char* cimgToHTMLImageData(cimg_library::CImg<unsigned char>& image);
 std::vector<Haarlike> generateFeatures(int s);
 std::string cascadeToJSON(CascadeClassifier& cascadeClassifier, float fpr, float fnr);
+CascadeClassifier* loadModelFile(std::string path);
+void reportDepths(CascadeClassifier& cascadeClassifier, std::vector<IntegralImage>& positiveValidationSet, 
+                  std::vector<IntegralImage>& negativeValidationSet);
+int countFeatures(CascadeClassifier& cascadeClassifier);
+float averageFeatures(CascadeClassifier& cascadeClassifier, std::vector<IntegralImage>& negativeValidationSet);
+void pruneCascade(CascadeClassifier& cascadeClassifier, float minWeight, std::vector<IntegralImage>& positiveValidationSet, 
+                  std::vector<IntegralImage>& negativeValidationSet, float targetFNR);
+void saveModel(CascadeClassifier& cascadeClassifier, std::string path, float fpr, float fnr);
 WeakClassifier optimizeWC(std::vector<WeakClassifier> potentialWCs, std::vector<float> posWeights, std::vector<float> negWeights);
 StrongClassifier adaBoost(CascadeClassifier& cascadeClassifier, std::vector<IntegralImage>& positiveSet, 
                           std::vector<IntegralImage>& negativeSet, std::vector<IntegralImage>& positiveValidationSet, 
@@ -1,140 +1,266 @@
-#include <iostream>
+#include <cstdio>
 #include <vector>
 #include <array>
 #include <cmath>
 #include <algorithm>
-#include <emscripten/emscripten.h>
-
-#include "../../lib/json.hpp"
+#include <cstring>
 
 #include "wasmface.h"
 #include "utility.h"
 #include "integral-image.h"
 #include "strong-classifier.h"
 #include "cascade-classifier.h"
+#include "window-stats.h"
+#include "sweep.h"
+#include "anytime-detector.h"
+#include "tracker.h"
+#include "box-grid.h"
+#include "post-processor.h"
+#include "detector.h"
+#include "multi-detector.h"
+#include "batch-detector.h"
+#include "stream-scheduler.h"
+#include "alloc-counter.h"
+#ifndef WASMFACE_SLIM
+#include "model-json.h"
+#endif
+#include "model-format.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/**
- * Compare two pointers based on their dereferenced values
- * @param  {Int*} a First pointer
- * @param  {Int*} b Second pointer
- * @return {Bool}   True if the first pointer's dereferenced value is the smaller of the two
- */
-bool compareDereferencedPtrs(int* a, int* b) {
-	return *a < *b;
-}
+// Subwindow counts from the most recent detection
+static int windowCount = 0;
+static int rejectedCount = 0;
 
 /**
  * Apply non-maximum suppression to a set of 1:1 aspect ratio bounding boxes
- * Bounding boxes are represented as [x, y, s] where s = width and height
  * @param  {std::vector<std::array<int, 3>>} boxes   The set of bounding boxes
  * @param  {Float}                           thresh  The minimum overlap ratio required for suppression
  * @param  {Float}                           nthresh The minimum number of neighboring boxes required for suppression
  * @return {std::vector<std::array<int, 3>>}         The suppressed set of bounding boxes
  */
 std::vector<std::array<int, 3>> nonMaxSuppression(std::vector<std::array<int, 3>>& boxes, float thresh, int nthresh) {
-	int len = boxes.size();
-	if (!len) return boxes;
-
-	// Destructure our bounding boxes into arrays representing upper left and lower right coords
-	int* x1 = new int[len];
-	int* y1 = new int[len];
-	int* x2 = new int[len];
-	int* y2 = new int[len];
-	int* area = new int[len];
-	for (int i = 0; i < len; i += 1) {
-		x1[i] = boxes[i][0];
-		y1[i] = boxes[i][1];
-		x2[i] = boxes[i][0] + boxes[i][2] - 1;
-		y2[i] = boxes[i][1] + boxes[i][2] - 1;
-		area[i] = std::pow(boxes[i][2], 2);
-	}
+	PostProcessor post;
+	post.boxes = boxes;
+	post.pick(thresh, nthresh);
+	std::vector<std::array<int, 3>> result(post.picked.size());
+	for (int i = 0; i < post.picked.size(); i += 1) result[i] = boxes[post.picked[i][0]];
+	return result;
+} 
 
-	// Create an array of the indices that would sort our y2 coords
-	int** ptrs = new int*[len];
-	for (int i = 0; i < len; i += 1) ptrs[i] = &y2[i];
-	std::sort(ptrs, ptrs + len, compareDereferencedPtrs);
-	std::vector<int> ind(len);
-	for (int i = 0; i < len; i += 1) ind[i] = ptrs[i] - &y2[0];
-
-	std::vector<std::pair<int, int>> pick;
-	while (ind.size() > 0) {
-		int last = ind.size() - 1;
-		int n = ind[last]; 
-		pick.push_back(std::pair<int, int> (n, 0));  
-		
-		// Suppress bounding boxes that overlap 
-		int neighborsCount = 0;
-		std::vector<int> suppress = {last};
-		for (int i = 0; i < last; i += 1) {
-			int j = ind[i];
-			int xx1 = std::max(x1[n], x1[j]);
-			int yy1 = std::max(y1[n], y1[j]);
-			int xx2 = std::min(x2[n], x2[j]);
-			int yy2 = std::min(y2[n], y2[j]);
-			int w = std::max(0, xx2 - xx1 + 1);
-			int h = std::max(0, yy2 - yy1 + 1);
-
-			float overlap = float(w * h) / area[j];
-
-			if (overlap > thresh) {
-				suppress.push_back(i);
-				neighborsCount += 1;
-			}
-		}
+/**
+ * Apply non-maximum suppression to a set of 1:1 aspect ratio bounding boxes, for callers without std::vector
+ * @param  {Int*}  boxes   Pointer to the bounding boxes, three elements [x, y, s] each
+ * @param  {Int}   count   Number of bounding boxes
+ * @param  {Float} thresh  The minimum overlap ratio required for suppression
+ * @param  {Int}   nthresh The minimum number of neighboring boxes required for suppression
+ * @param  {Int*}  out     Pointer to a buffer to write the suppressed set to, with room for count bounding boxes
+ * @return {Int}           Number of bounding boxes in the suppressed set
+ */
+EMSCRIPTEN_KEEPALIVE int suppressNonMaxima(int boxes[], int count, float thresh, int nthresh, int out[]) {
+	std::vector<std::array<int, 3>> input(std::max(0, count));
+	for (int i = 0; i < input.size(); i += 1) input[i] = {boxes[i * 3], boxes[i * 3 + 1], boxes[i * 3 + 2]};
+	std::vector<std::array<int, 3>> result = nonMaxSuppression(input, thresh, nthresh);
+	for (int i = 0; i < result.size(); i += 1) std::copy(result[i].begin(), result[i].end(), out + i * 3);
+	return result.size();
+}
 
-		for (int i = 0; i < suppress.size(); i += 1) ind.erase(ind.begin() + suppress[i]);
-		pick.back().second = neighborsCount;
-	}
+/**
+ * Group a set of 1:1 aspect ratio bounding boxes into clusters of overlapping boxes
+ * @param  {std::vector<std::array<int, 3>>} boxes   The set of bounding boxes
+ * @param  {Float}                           thresh  The minimum overlap ratio required to link two boxes
+ * @param  {Int}                             nthresh The minimum number of neighboring boxes required to keep a cluster
+ * @return {std::vector<std::array<int, 4>>}         The averaged box of each cluster [x, y, s, n] where n = number of neighbors
+ */
+std::vector<std::array<int, 4>> groupDetections(std::vector<std::array<int, 3>>& boxes, float thresh, int nthresh) {
+	PostProcessor post;
+	post.boxes = boxes;
+	int clusters = post.cluster(thresh);
 
-	delete [] x1;
-	delete [] y1;
-	delete [] x2;
-	delete [] y2;
-	delete [] area;
-	delete [] ptrs;
-
-	// Also suppress boxes that do not have the minimum number of neighbors
-	std::vector<std::array<int, 3>> result;
-	for (int i = 0; i < pick.size(); i += 1) {
-		if (pick[i].second >= nthresh) result.push_back(boxes[pick[i].first]);
+	// Average each cluster
+	std::vector<std::array<double, 4>> sums(clusters, {0, 0, 0, 0});
+	for (int i = 0; i < boxes.size(); i += 1) {
+		auto& sum = sums[post.labels[i]];
+		sum[0] += boxes[i][0];
+		sum[1] += boxes[i][1];
+		sum[2] += boxes[i][2];
+		sum[3] += 1;
+	}
+	std::vector<std::array<int, 4>> result;
+	for (int i = 0; i < sums.size(); i += 1) {
+		int neighbors = sums[i][3] - 1;
+		if (neighbors < nthresh) continue;
+		std::array<int, 4> averaged = {
+			int(std::lround(sums[i][0] / sums[i][3])), 
+			int(std::lround(sums[i][1] / sums[i][3])), 
+			int(std::lround(sums[i][2] / sums[i][3])), 
+			neighbors
+		};
+		result.push_back(averaged);
 	}
 	return result;
-} 
+}
+
+/**
+ * Apply post processing to a set of 1:1 aspect ratio bounding boxes
+ * @param  {std::vector<std::array<int, 3>>} boxes   The set of bounding boxes
+ * @param  {Int}                             pp      0 for none, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}                           othresh Overlap threshold for post processing
+ * @param  {Int}                             nthresh Neighbor threshold for post processing
+ * @return {std::vector<std::array<int, 3>>}         The post processed set of bounding boxes
+ */
+std::vector<std::array<int, 3>> postProcess(std::vector<std::array<int, 3>>& boxes, int pp, float othresh, int nthresh) {
+	if (pp == 1) return nonMaxSuppression(boxes, othresh, nthresh);
+	if (pp != 2) return boxes;
+
+	auto groups = groupDetections(boxes, othresh, nthresh);
+	std::vector<std::array<int, 3>> result(groups.size());
+	for (int i = 0; i < groups.size(); i += 1) result[i] = {groups[i][0], groups[i][1], groups[i][2]};
+	return result;
+}
+
+/**
+ * Pack a set of bounding boxes into a 1D array on the heap with its length stashed as the first element
+ * @param  {std::vector<std::array<int, 3>>} roi The bounding boxes
+ * @return {uint16_t*}                           Pointer to an array of bounding box geometry
+ */
+uint16_t* packBoxes(std::vector<std::array<int, 3>>& roi) {
+	int blen = roi.size() * 3 + 1;
+	uint16_t* boxes = new uint16_t[blen];
+	boxes[0] = blen;
+	for (int i = 0, j = 1; i < roi.size(); i += 1, j += 3) {
+		boxes[j] = roi[i][0];
+		boxes[j + 1] = roi[i][1];
+		boxes[j + 2] = roi[i][2];
+	}
+	return boxes;
+}
 
+/**
+ * Free an array of bounding box geometry returned by detect
+ * @param {uint16_t*} boxes Pointer to the array
+ */
+EMSCRIPTEN_KEEPALIVE void destroyBoxes(uint16_t* boxes) {
+	delete[] boxes;
+}
+
+/**
+ * Pack a set of scored detections into a 1D array on the heap with the number of detections stashed as the first element
+ * Each detection takes seven 32-bit elements [x, y, s, depth, margin, neighbors, label], where margin is a float
+ * @param  {std::vector<Detection>} found The scored detections
+ * @return {Int*}                         Pointer to an array of detection records
+ */
+int* packDetections(std::vector<Detection>& found) {
+	static_assert(sizeof(Detection) == 7 * sizeof(int), "Detection records must be seven 32-bit elements");
+	int* packed = new int[found.size() * 7 + 1];
+	packed[0] = found.size();
+	if (found.size()) std::memcpy(packed + 1, found.data(), found.size() * sizeof(Detection));
+	return packed;
+}
+
+/**
+ * Free an array of detection records returned by detectScored
+ * @param {Int*} detections Pointer to the array
+ */
+EMSCRIPTEN_KEEPALIVE void destroyDetections(int* detections) {
+	delete[] detections;
+}
+
+/**
+ * Write scored detections to a buffer owned by the caller
+ * The buffer holds a header of two 32-bit elements [count, overflow] followed by capacity detection records
+ * @param  {std::vector<Detection>} found    The scored detections
+ * @param  {Int*}                   out      Pointer to the output buffer, at least 2 + capacity * 7 elements long
+ * @param  {Int}                    capacity Maximum number of detection records the output buffer can hold
+ * @return {Int}                             Number of detections, which is more than capacity on overflow
+ */
+int writeDetections(std::vector<Detection>& found, int* out, int capacity) {
+	int count = std::min(int(found.size()), std::max(0, capacity));
+	out[0] = count;
+	out[1] = found.size() > count;
+	if (count) std::memcpy(out + 2, found.data(), count * sizeof(Detection));
+	return found.size();
+}
+
+#ifndef WASMFACE_SLIM
 /**
  * Deserialize and construct a cascade classifier object
  * @param  {Char*}              model A serialized cascade classifier object
- * @return {CascadeClassifier*}       A pointer to a new cascade classifier object
+ * @return {CascadeClassifier*}       A pointer to a new cascade classifier object, or null if the model is malformed
  */
 EMSCRIPTEN_KEEPALIVE CascadeClassifier* create(char model[]) {
-	auto ccJSON = nlohmann::json::parse(model);
-
-	std::vector<StrongClassifier> sc;
-	for (int i = 0; i < ccJSON["strongClassifiers"].size(); i += 1) {
-		StrongClassifier strongClassifier;
-		strongClassifier.threshold = ccJSON["strongClassifiers"][i]["threshold"];
-		for (int j = 0; j < ccJSON["strongClassifiers"][i]["weakClassifiers"].size(); j += 1) {
-			WeakClassifier weakClassifier;
-			weakClassifier.haarlike.type = ccJSON["strongClassifiers"][i]["weakClassifiers"][j]["type"];
-			weakClassifier.haarlike.w = ccJSON["strongClassifiers"][i]["weakClassifiers"][j]["w"];
-			weakClassifier.haarlike.h = ccJSON["strongClassifiers"][i]["weakClassifiers"][j]["h"];
-			weakClassifier.haarlike.x = ccJSON["strongClassifiers"][i]["weakClassifiers"][j]["x"];
-			weakClassifier.haarlike.y = ccJSON["strongClassifiers"][i]["weakClassifiers"][j]["y"];
-			weakClassifier.threshold = ccJSON["strongClassifiers"][i]["weakClassifiers"][j]["threshold"];
-			weakClassifier.polarity = ccJSON["strongClassifiers"][i]["weakClassifiers"][j]["polarity"];
-			strongClassifier.weakClassifiers.push_back(weakClassifier);
-			strongClassifier.weights.push_back(ccJSON["strongClassifiers"][i]["weights"][j]);
-		}
-		sc.push_back(strongClassifier);
-	}
+	return cascadeFromJSON(model);
+}
+#endif
+
+/**
+ * Construct a cascade classifier object from a model in the binary model format
+ * @param  {Unsigned char*}     bytes Pointer to the model
+ * @param  {Int}                size  Size of the model in bytes
+ * @return {CascadeClassifier*}       A pointer to a new cascade classifier object, or null if the model is malformed
+ */
+EMSCRIPTEN_KEEPALIVE CascadeClassifier* createFromBinary(unsigned char bytes[], int size) {
+	return cascadeFromBinary(bytes, size);
+}
+
+/**
+ * Construct a cascade classifier object from the leading stages of a binary model that have arrived so far
+ * The cascade runs with the stages it has, detecting faster but with more false positives, until extendFromBinary
+ * adds the rest. Detectors built on it pick up new stages on their next frame
+ * @param  {Unsigned char*}     bytes Pointer to the model, which may be incomplete
+ * @param  {Int}                size  Number of bytes of the model available
+ * @return {CascadeClassifier*}       A pointer to a new cascade classifier object, or null if the model is malformed or
+ *                                    not a single stage has arrived
+ */
+EMSCRIPTEN_KEEPALIVE CascadeClassifier* createFromBinaryPrefix(unsigned char bytes[], int size) {
+	return cascadeFromBinaryPrefix(bytes, size);
+}
+
+/**
+ * Add the stages of a binary model that have arrived since a cascade classifier object was created or last extended
+ * Not safe while another thread is detecting with the cascade, as in a stream scheduler
+ * @param  {CascadeClassifier*} cc    Pointer to a cascade classifier object created by createFromBinaryPrefix
+ * @param  {Unsigned char*}     bytes Pointer to the model, which may still be incomplete
+ * @param  {Int}                size  Number of bytes of the model available
+ * @return {Int}                      Number of stages the cascade has now, or -1 if the model is malformed or isn't
+ *                                    the one the cascade was created from
+ */
+EMSCRIPTEN_KEEPALIVE int extendFromBinary(CascadeClassifier* cc, unsigned char bytes[], int size) {
+	if (appendFromBinary(*cc, bytes, size) < 0) return -1;
+	return cc->strongClassifiers.size();
+}
+
+/**
+ * Count the stages of a binary model that are complete in the bytes that have arrived so far
+ * @param  {Unsigned char*} bytes Pointer to the model, which may be incomplete
+ * @param  {Int}            size  Number of bytes of the model available
+ * @return {Int}                  Number of complete stages, or -1 if the header and stage table are incomplete or malformed
+ */
+EMSCRIPTEN_KEEPALIVE int getAvailableStages(unsigned char bytes[], int size) {
+	return binaryStagesAvailable(bytes, size);
+}
+
+/**
+ * Get the number of stages in a cascade classifier object
+ * @param  {CascadeClassifier*} cc Pointer to a cascade classifier object
+ * @return {Int}                   Number of stages
+ */
+EMSCRIPTEN_KEEPALIVE int getStageCount(CascadeClassifier* cc) {
+	return cc->strongClassifiers.size();
+}
 
-	CascadeClassifier* cc = new CascadeClassifier(ccJSON["baseResolution"], sc);
-	return cc;
+#ifndef __EMSCRIPTEN__
+/**
+ * Construct a cascade classifier object from a binary model file
+ * @param  {Char*}              path Path to the model file
+ * @return {CascadeClassifier*}      A pointer to a new cascade classifier object, or null if the file can't be read
+ */
+EMSCRIPTEN_KEEPALIVE CascadeClassifier* createFromFile(char path[]) {
+	return loadBinaryModel(path);
 }
+#endif
 
 /**
  * Destroy a cascade classifier object
@@ -153,66 +279,730 @@ EMSCRIPTEN_KEEPALIVE void destroy(CascadeClassifier* cc) {
  * @param  {CascadeClassifier*} cco      Pointer to a cascade classifier object
  * @param  {Float}              step     Detector scale step to apply
  * @param  {Float}              delta    Detector sweep delta to apply
- * @param  {Bool}               pp       True applies post processing
+ * @param  {Int}                pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
  * @param  {Float}              othresh  Overlap threshold for post processing
  * @param  {Float}              nthresh  Neighbor threshold for post processing
+ * @param  {Float}              minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
  * @return {uint16_t*}                   Pointer to an array of bounding box geometry
  */
 EMSCRIPTEN_KEEPALIVE uint16_t* detect(unsigned char inputBuf[], int w, int h, CascadeClassifier* cco, 
-                                      float step, float delta, bool pp, float othresh, int nthresh) {
-	CascadeClassifier* cc = new CascadeClassifier(*cco);
-	
-	int byteSize = w * h * 4;
-	auto fpgs = toGrayscaleFloat(inputBuf, w, h);
-	auto integral = IntegralImage(fpgs, w, h, byteSize, false);
-	auto integralSquared = IntegralImage(fpgs, w, h, byteSize, true);
-	delete [] fpgs;
-
-	// Sweep and scale the detector over the post-normalized input image and collect detections
-	std::vector<std::array<int, 3>> roi;
-	while (cc->baseResolution < w && cc->baseResolution < h) {
-		for (int y = 0; y < h - cc->baseResolution; y += step * delta) {
-			for (int x = 0; x < w - cc->baseResolution; x += step * delta) {
-				float sum = integral.getRectangleSum(x, y, cc->baseResolution, cc->baseResolution);
-				float squaredSum = integralSquared.getRectangleSum(x, y, cc->baseResolution, cc->baseResolution);
-				float area = std::pow(cc->baseResolution, 2);
-				float mean = sum / area;
-				float sd = std::sqrt(squaredSum / area - std::pow(mean, 2));
-				bool c = cc->classify(integral, x, y, mean, sd);
-				
-				if (c) {
-					std::array<int, 3> bounding = {x, y, cc->baseResolution};
-					roi.push_back(bounding);
-				}
-			}
+                                      float step, float delta, int pp, float othresh, int nthresh, float minsd) {
+	Detector detector(*cco, w, h, step, delta);
+	auto& found = detector.detect(inputBuf, pp, othresh, nthresh, minsd, 0);
+	windowCount = detector.windowCount;
+	rejectedCount = detector.rejectedCount;
+
+	AllocScope scope(ALLOC_OUTPUT);
+	std::vector<std::array<int, 3>> roi(found.size());
+	for (int i = 0; i < found.size(); i += 1) roi[i] = {found[i].x, found[i].y, found[i].s};
+	return packBoxes(roi);
+}
+
+/**
+ * Use a cascade classifier to detect objects in an HTML5 ImageData buffer and score each detection
+ * A detection's depth is the number of stages it passed and its margin is its score minus the threshold of the
+ * last stage it ran, so positive detections have full depth and a margin of at least 0
+ * @param  {Unsigned char*}     inputBuf Pointer to an HTML5 ImageData buffer
+ * @param  {Int}                w        Width of the ImageData object
+ * @param  {Int}                h        Height of the ImageData object
+ * @param  {CascadeClassifier*} cco      Pointer to a cascade classifier object
+ * @param  {Float}              step     Detector scale step to apply
+ * @param  {Float}              delta    Detector sweep delta to apply
+ * @param  {Int}                pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}              othresh  Overlap threshold for post processing
+ * @param  {Float}              nthresh  Neighbor threshold for post processing
+ * @param  {Float}              minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @param  {Int}                mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @return {Int*}                        Pointer to an array of detection records [x, y, s, depth, margin, neighbors, label]
+ */
+EMSCRIPTEN_KEEPALIVE int* detectScored(unsigned char inputBuf[], int w, int h, CascadeClassifier* cco, float step, 
+                                       float delta, int pp, float othresh, int nthresh, float minsd, int mindepth) {
+	Detector detector(*cco, w, h, step, delta);
+	auto& found = detector.detect(inputBuf, pp, othresh, nthresh, minsd, mindepth);
+	windowCount = detector.windowCount;
+	rejectedCount = detector.rejectedCount;
+
+	AllocScope scope(ALLOC_OUTPUT);
+	return packDetections(found);
+}
+
+/**
+ * Use a cascade classifier to detect objects in an HTML5 ImageData buffer, writing scored detections to a buffer
+ * owned by the caller, so that the same buffer can be reused across calls without allocating
+ * The buffer holds a header of two 32-bit elements [count, overflow] followed by capacity detection records
+ * [x, y, s, depth, margin, neighbors, label]. When more than capacity detections are found, the first capacity are
+ * written and the overflow flag is set
+ * @param  {Unsigned char*}     inputBuf Pointer to an HTML5 ImageData buffer
+ * @param  {Int}                w        Width of the ImageData object
+ * @param  {Int}                h        Height of the ImageData object
+ * @param  {CascadeClassifier*} cco      Pointer to a cascade classifier object
+ * @param  {Float}              step     Detector scale step to apply
+ * @param  {Float}              delta    Detector sweep delta to apply
+ * @param  {Int}                pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}              othresh  Overlap threshold for post processing
+ * @param  {Float}              nthresh  Neighbor threshold for post processing
+ * @param  {Float}              minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @param  {Int}                mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @param  {Int*}               out      Pointer to the output buffer, at least 2 + capacity * 7 elements long
+ * @param  {Int}                capacity Maximum number of detection records the output buffer can hold
+ * @return {Int}                         Number of detections found, which is more than capacity on overflow
+ */
+EMSCRIPTEN_KEEPALIVE int detectInto(unsigned char inputBuf[], int w, int h, CascadeClassifier* cco, float step, float delta, 
+                                    int pp, float othresh, int nthresh, float minsd, int mindepth, int* out, int capacity) {
+	Detector detector(*cco, w, h, step, delta);
+	return detectWith(&detector, inputBuf, pp, othresh, nthresh, minsd, mindepth, out, capacity);
+}
+
+/**
+ * Construct a detector session for frames of a fixed size
+ * The session owns the scaled cascade classifiers and every workspace buffer, so that detecting with it again
+ * makes no heap allocations
+ * @param  {CascadeClassifier*} cc    Pointer to a cascade classifier object
+ * @param  {Int}                w     Width of the frames to be processed
+ * @param  {Int}                h     Height of the frames to be processed
+ * @param  {Float}              step  Detector scale step to apply
+ * @param  {Float}              delta Detector sweep delta to apply
+ * @return {Detector*}                A pointer to a new detector object
+ */
+EMSCRIPTEN_KEEPALIVE Detector* createDetector(CascadeClassifier* cc, int w, int h, float step, float delta) {
+	return new Detector(*cc, w, h, step, delta);
+}
+
+/**
+ * Destroy a detector object
+ * @param {Detector*} dt Pointer to the detector to destroy
+ */
+EMSCRIPTEN_KEEPALIVE void destroyDetector(Detector* dt) {
+	delete dt;
+}
+
+/**
+ * Use a detector session to detect objects in an HTML5 ImageData buffer, writing scored detections to a buffer
+ * owned by the caller, laid out as for detectInto
+ * @param  {Detector*}      dt       Pointer to a detector object
+ * @param  {Unsigned char*} inputBuf Pointer to an HTML5 ImageData buffer
+ * @param  {Int}            pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}          othresh  Overlap threshold for post processing
+ * @param  {Float}          nthresh  Neighbor threshold for post processing
+ * @param  {Float}          minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @param  {Int}            mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @param  {Int*}           out      Pointer to the output buffer, at least 2 + capacity * 7 elements long
+ * @param  {Int}            capacity Maximum number of detection records the output buffer can hold
+ * @return {Int}                     Number of detections found, which is more than capacity on overflow
+ */
+EMSCRIPTEN_KEEPALIVE int detectWith(Detector* dt, unsigned char inputBuf[], int pp, float othresh, int nthresh, 
+                                    float minsd, int mindepth, int* out, int capacity) {
+	auto& found = dt->detect(inputBuf, pp, othresh, nthresh, minsd, mindepth);
+	windowCount = dt->windowCount;
+	rejectedCount = dt->rejectedCount;
+
+	AllocScope scope(ALLOC_OUTPUT);
+	return writeDetections(found, out, capacity);
+}
+
+/**
+ * Limit the depth of a detector session's cascade and shift its stage thresholds, trading recall and precision for
+ * speed without retraining. Applied to the session's scaled copies of the cascade, never to the loaded model
+ * @param {Detector*} dt        Pointer to a detector object
+ * @param {Int}       maxStages Number of stages to run (0 runs every stage)
+ * @param {Float*}    offsets   Pointer to an array of amounts to add to each stage's threshold, by stage
+ * @param {Int}       count     Number of offsets, stages past the last offset are left as is
+ */
+EMSCRIPTEN_KEEPALIVE void tuneDetector(Detector* dt, int maxStages, float offsets[], int count) {
+	std::vector<float> tuning(offsets, offsets + std::max(0, count));
+	dt->tune(maxStages, tuning);
+}
+
+/**
+ * Get the time a detector session's most recent detection spent in a phase
+ * @param  {Detector*} dt    Pointer to a detector object
+ * @param  {Int}       phase 0 for rebuilding the scales, 1 for grayscale, 2 for integral, 3 for sweep, 4 for post processing
+ * @return {Double}          Time in milliseconds
+ */
+EMSCRIPTEN_KEEPALIVE double getPhaseTime(Detector* dt, int phase) {
+	if (phase < 0 || phase >= ALLOC_PHASES) return 0;
+	return dt->phaseTimes[phase];
+}
+
+/**
+ * Get the generation of a detector session's scaled cascade classifiers, which changes whenever they are rebuilt or
+ * the frame width changes, detaching any compiled code
+ * @param  {Detector*} dt Pointer to a detector object
+ * @return {Int}          The generation
+ */
+EMSCRIPTEN_KEEPALIVE int getDetectorGeneration(Detector* dt) {
+	return dt->generation;
+}
+
+/**
+ * Get the number of scaled cascade classifiers in a detector session
+ * @param  {Detector*} dt Pointer to a detector object
+ * @return {Int}          Number of scales
+ */
+EMSCRIPTEN_KEEPALIVE int getDetectorScales(Detector* dt) {
+	return dt->scales.size();
+}
+
+/**
+ * Get the stride of a detector session's integral images, in values per row
+ * @param  {Detector*} dt Pointer to a detector object
+ * @return {Int}          The stride
+ */
+EMSCRIPTEN_KEEPALIVE int getIntegralStride(Detector* dt) {
+	return dt->integral.stride;
+}
+
+/**
+ * Write one of a detector session's scaled cascade classifiers in the binary model format, tuning included, for
+ * compiling to code
+ * @param  {Detector*}      dt       Pointer to a detector object
+ * @param  {Int}            scale    Index of the scale
+ * @param  {Unsigned char*} out      Pointer to a buffer to write the model to
+ * @param  {Int}            capacity Size of the buffer in bytes
+ * @return {Int}                     Size of the model in bytes, which is written only if it fits, or -1 if there is no
+ *                                    such scale
+ */
+EMSCRIPTEN_KEEPALIVE int exportScale(Detector* dt, int scale, unsigned char out[], int capacity) {
+	if (scale < 0 || scale >= dt->scales.size()) return -1;
+	std::string bytes = cascadeToBinary(dt->scales[scale], 0, 0);
+	if (bytes.size() <= capacity) std::copy(bytes.begin(), bytes.end(), out);
+	return bytes.size();
+}
+
+/**
+ * Send detection at one scale of a detector session through compiled code instead of the interpreter
+ * @param  {Detector*}       dt         Pointer to a detector object
+ * @param  {Int}             generation Generation of the scales the code was compiled from
+ * @param  {Int}             scale      Index of the scale
+ * @param  {CompiledCascade} fn         The compiled cascade classifier, or null to go back to the interpreter
+ * @return {Int}                        1 if attached, 0 if the scales have been rebuilt since the code was compiled
+ */
+EMSCRIPTEN_KEEPALIVE int attachCompiledScale(Detector* dt, int generation, int scale, CompiledCascade fn) {
+	if (generation != dt->generation || scale < 0 || scale >= dt->compiled.size()) return 0;
+	dt->compiled[scale] = fn;
+	return 1;
+}
+
+/**
+ * Get a key for caching code compiled from a detector session's scales
+ * It changes whenever the scales are built from a different model, step, reach or tuning, and with the build, but
+ * not with the integral image stride, which the caller must add to the key
+ * @param {Detector*} dt  Pointer to a detector object
+ * @param {Uint32*}   out Pointer to an array of two to write the key to, low half first
+ */
+EMSCRIPTEN_KEEPALIVE void getDetectorKey(Detector* dt, uint32_t out[]) {
+	uint64_t key = dt->cacheKey();
+	out[0] = uint32_t(key);
+	out[1] = uint32_t(key >> 32);
+}
+
+/**
+ * Construct a detector session that runs several cascade classifiers over frames of a fixed size
+ * @param  {CascadeClassifier**} models Pointer to an array of pointers to cascade classifier objects
+ * @param  {Int}                 count  Number of cascade classifiers, which are labeled 0 to count - 1
+ * @param  {Int}                 w      Width of the frames to be processed
+ * @param  {Int}                 h      Height of the frames to be processed
+ * @param  {Float}               step   Detector scale step to apply
+ * @param  {Float}               delta  Detector sweep delta to apply
+ * @return {MultiDetector*}             A pointer to a new multi detector object
+ */
+EMSCRIPTEN_KEEPALIVE MultiDetector* createMultiDetector(CascadeClassifier** models, int count, int w, int h, float step, float delta) {
+	std::vector<CascadeClassifier*> cascades(models, models + count);
+	return new MultiDetector(cascades, w, h, step, delta);
+}
+
+/**
+ * Destroy a multi detector object
+ * @param {MultiDetector*} md Pointer to the multi detector to destroy
+ */
+EMSCRIPTEN_KEEPALIVE void destroyMultiDetector(MultiDetector* md) {
+	delete md;
+}
+
+/**
+ * Use a multi detector session to detect objects with every one of its models in an HTML5 ImageData buffer,
+ * writing scored detections labeled by model to a buffer owned by the caller, laid out as for detectInto
+ * @param  {MultiDetector*} md       Pointer to a multi detector object
+ * @param  {Unsigned char*} inputBuf Pointer to an HTML5 ImageData buffer
+ * @param  {Int}            pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}          othresh  Overlap threshold for post processing
+ * @param  {Float}          nthresh  Neighbor threshold for post processing
+ * @param  {Float}          minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @param  {Int}            mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @param  {Int*}           out      Pointer to the output buffer, at least 2 + capacity * 7 elements long
+ * @param  {Int}            capacity Maximum number of detection records the output buffer can hold
+ * @return {Int}                     Number of detections found, which is more than capacity on overflow
+ */
+EMSCRIPTEN_KEEPALIVE int detectMulti(MultiDetector* md, unsigned char inputBuf[], int pp, float othresh, int nthresh, 
+                                     float minsd, int mindepth, int* out, int capacity) {
+	auto& found = md->detect(inputBuf, pp, othresh, nthresh, minsd, mindepth);
+	windowCount = md->windowCount;
+	rejectedCount = md->rejectedCount;
+
+	AllocScope scope(ALLOC_OUTPUT);
+	return writeDetections(found, out, capacity);
+}
+
+/**
+ * Construct a batch detector for images of any size
+ * Its worker threads start here and are reused by every batch
+ * @param  {CascadeClassifier*} cc      Pointer to a cascade classifier object
+ * @param  {Float}              step    Detector scale step to apply
+ * @param  {Float}              delta   Detector sweep delta to apply
+ * @param  {Int}                threads Number of worker threads, forced to 1 in builds without thread support
+ * @return {BatchDetector*}             A pointer to a new batch detector object
+ */
+EMSCRIPTEN_KEEPALIVE BatchDetector* createBatchDetector(CascadeClassifier* cc, float step, float delta, int threads) {
+	return new BatchDetector(*cc, step, delta, threads);
+}
+
+/**
+ * Destroy a batch detector object
+ * @param {BatchDetector*} bd Pointer to the batch detector to destroy
+ */
+EMSCRIPTEN_KEEPALIVE void destroyBatchDetector(BatchDetector* bd) {
+	delete bd;
+}
+
+/**
+ * Use a batch detector to detect objects in many HTML5 ImageData buffers in one call, writing one table of scored
+ * detections for the whole batch to a buffer owned by the caller
+ * The buffer holds the number of records written and an overflow flag, then count + 1 offsets into the records
+ * where the detections of each image start, so image i owns records offsets[i] to offsets[i + 1], then the
+ * records laid out as for detectInto. Offsets are clamped to capacity, so on overflow the images at the end of the
+ * batch come back short or empty and the return value gives the capacity to retry with
+ * @param  {BatchDetector*}   bd       Pointer to a batch detector object
+ * @param  {ImageDescriptor*} images   Pointer to an array of image descriptors, each a buffer pointer, width and height
+ * @param  {Int}              count    Number of images in the batch
+ * @param  {Int}              pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}            othresh  Overlap threshold for post processing
+ * @param  {Float}            nthresh  Neighbor threshold for post processing
+ * @param  {Float}            minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @param  {Int}              mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @param  {Int*}             out      Pointer to the output buffer, at least 3 + count + capacity * 7 elements long
+ * @param  {Int}              capacity Maximum number of detection records the output buffer can hold
+ * @return {Int}                       Number of detections found in the batch, which is more than capacity on overflow
+ */
+EMSCRIPTEN_KEEPALIVE int detectBatch(BatchDetector* bd, ImageDescriptor* images, int count, int pp, float othresh, 
+                                     int nthresh, float minsd, int mindepth, int* out, int capacity) {
+	auto& results = bd->detect(images, count, pp, othresh, nthresh, minsd, mindepth);
+	windowCount = bd->windowCount;
+	rejectedCount = bd->rejectedCount;
+
+	AllocScope scope(ALLOC_OUTPUT);
+	int* offsets = out + 2;
+	Detection* records = reinterpret_cast<Detection*>(offsets + count + 1);
+	int total = 0;
+	capacity = std::max(0, capacity);
+	for (int i = 0; i < count; i += 1) {
+		int start = std::min(total, capacity);
+		int n = std::min(int(results[i].size()), capacity - start);
+		offsets[i] = start;
+		if (n > 0) std::memcpy(records + start, results[i].data(), n * sizeof(Detection));
+		total += results[i].size();
+	}
+	offsets[count] = std::min(total, capacity);
+	out[0] = offsets[count];
+	out[1] = total > capacity;
+	return total;
+}
+
+#ifdef WASMFACE_THREADS
+/**
+ * Construct a stream scheduler and start its worker threads
+ * @param  {Int}              workers Number of worker threads
+ * @return {StreamScheduler*}         A pointer to a new stream scheduler object
+ */
+EMSCRIPTEN_KEEPALIVE StreamScheduler* createScheduler(int workers) {
+	return new StreamScheduler(workers);
+}
+
+/**
+ * Stop a stream scheduler's worker threads and destroy it
+ * @param {StreamScheduler*} sch Pointer to the stream scheduler to destroy
+ */
+EMSCRIPTEN_KEEPALIVE void destroyScheduler(StreamScheduler* sch) {
+	delete sch;
+}
+
+/**
+ * Add a video stream to a stream scheduler
+ * @param  {StreamScheduler*}   sch      Pointer to a stream scheduler object
+ * @param  {CascadeClassifier*} cc       Pointer to a cascade classifier object
+ * @param  {Int}                w        Width of the stream's frames
+ * @param  {Int}                h        Height of the stream's frames
+ * @param  {Float}              step     Detector scale step to apply
+ * @param  {Float}              delta    Detector sweep delta to apply
+ * @param  {Int}                pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}              othresh  Overlap threshold for post processing
+ * @param  {Float}              nthresh  Neighbor threshold for post processing
+ * @param  {Float}              minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @param  {Int}                mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @param  {Float}              target   Latency target in milliseconds, from a frame's submission to its detections
+ * @return {Int}                         Index of the new stream
+ */
+EMSCRIPTEN_KEEPALIVE int addStream(StreamScheduler* sch, CascadeClassifier* cc, int w, int h, float step, float delta, 
+                                   int pp, float othresh, int nthresh, float minsd, int mindepth, float target) {
+	return sch->add(*cc, w, h, step, delta, pp, othresh, nthresh, minsd, mindepth, target);
+}
+
+/**
+ * Submit a frame to a stream, replacing and dropping any frame of the stream still waiting for a worker
+ * @param  {StreamScheduler*} sch      Pointer to a stream scheduler object
+ * @param  {Int}              stream   Index of the stream
+ * @param  {Unsigned char*}   inputBuf Pointer to an HTML5 ImageData buffer, copied before this returns
+ * @return {Int}                       Sequence number of the frame within its stream
+ */
+EMSCRIPTEN_KEEPALIVE int submitFrame(StreamScheduler* sch, int stream, unsigned char inputBuf[]) {
+	return sch->submit(stream, inputBuf);
+}
+
+/**
+ * Write the scored detections from a stream's most recently processed frame to a buffer owned by the caller, laid
+ * out as for detectInto. The frame's sequence number is reported by getStreamStats
+ * @param  {StreamScheduler*} sch      Pointer to a stream scheduler object
+ * @param  {Int}              stream   Index of the stream
+ * @param  {Int*}             out      Pointer to the output buffer, at least 2 + capacity * 7 elements long
+ * @param  {Int}              capacity Maximum number of detection records the output buffer can hold
+ * @return {Int}                       Number of detections, which is more than capacity on overflow
+ */
+EMSCRIPTEN_KEEPALIVE int readStream(StreamScheduler* sch, int stream, int* out, int capacity) {
+	thread_local std::vector<Detection> found;
+	sch->read(stream, found);
+	return writeDetections(found, out, capacity);
+}
+
+/**
+ * Get a stream's throughput and latency stats
+ * @param {StreamScheduler*} sch    Pointer to a stream scheduler object
+ * @param {Int}              stream Index of the stream
+ * @param {StreamStats*}     out    Pointer to the stats to fill in
+ */
+EMSCRIPTEN_KEEPALIVE void getStreamStats(StreamScheduler* sch, int stream, StreamStats* out) {
+	*out = sch->stats(stream);
+}
+#endif
+
+/**
+ * Construct an anytime detector for frames of a fixed size
+ * @param  {CascadeClassifier*} cc    Pointer to a cascade classifier object
+ * @param  {Int}                w     Width of the frames to be processed
+ * @param  {Int}                h     Height of the frames to be processed
+ * @param  {Float}              step  Detector scale step to apply
+ * @param  {Float}              delta Detector sweep delta to apply
+ * @return {AnytimeDetector*}         A pointer to a new anytime detector object
+ */
+EMSCRIPTEN_KEEPALIVE AnytimeDetector* createAnytime(CascadeClassifier* cc, int w, int h, float step, float delta) {
+	return new AnytimeDetector(*cc, w, h, step, delta);
+}
+
+/**
+ * Destroy an anytime detector object
+ * @param {AnytimeDetector*} ad Pointer to the anytime detector to destroy
+ */
+EMSCRIPTEN_KEEPALIVE void destroyAnytime(AnytimeDetector* ad) {
+	delete ad;
+}
+
+/**
+ * Write the bounding boxes from an anytime detector's most recent frame to a buffer owned by the caller
+ * The buffer holds a header of two 32-bit elements [count, overflow] followed by capacity box records [x, y, s]
+ * @param  {AnytimeDetector*} ad       Pointer to an anytime detector object
+ * @param  {Int*}             out      Pointer to the output buffer, at least 2 + capacity * 3 elements long
+ * @param  {Int}              capacity Maximum number of box records the output buffer can hold
+ * @return {Int}                       Number of boxes, which is more than capacity on overflow
+ */
+EMSCRIPTEN_KEEPALIVE int readAnytime(AnytimeDetector* ad, int* out, int capacity) {
+	int count = ad->previous.size();
+	out[0] = std::min(count, std::max(0, capacity));
+	out[1] = count > out[0];
+	for (int i = 0; i < out[0]; i += 1) std::copy(ad->previous[i].begin(), ad->previous[i].end(), out + 2 + i * 3);
+	return count;
+}
+
+/**
+ * Use an anytime detector to detect objects in an HTML5 ImageData buffer within a time budget
+ * Detection stops when the budget runs out and the next call resumes the scan where this one stopped. The boxes are
+ * written as for readAnytime. On overflow, call readAnytime with a larger buffer rather than detecting again
+ * @param  {AnytimeDetector*} ad       Pointer to an anytime detector object
+ * @param  {Unsigned char*}   inputBuf Pointer to an HTML5 ImageData buffer
+ * @param  {Float}            budget   Time budget in milliseconds
+ * @param  {Int}              pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}            othresh  Overlap threshold for post processing
+ * @param  {Float}            nthresh  Neighbor threshold for post processing
+ * @param  {Float}            minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @param  {Int*}             out      Pointer to the output buffer, at least 2 + capacity * 3 elements long
+ * @param  {Int}              capacity Maximum number of box records the output buffer can hold
+ * @return {Int}                       Number of boxes, which is more than capacity on overflow
+ */
+EMSCRIPTEN_KEEPALIVE int detectAnytime(AnytimeDetector* ad, unsigned char inputBuf[], float budget, int pp, float othresh, 
+                                       int nthresh, float minsd, int* out, int capacity) {
+	auto& roi = ad->detect(inputBuf, budget, minsd);
+	auto& boxes = ad->post.run(roi, pp, othresh, nthresh);
+	ad->previous.assign(boxes.begin(), boxes.end());
+	return readAnytime(ad, out, capacity);
+}
+
+/**
+ * Get the coverage report from an anytime detector's most recent frame
+ * @param  {AnytimeDetector*} ad Pointer to an anytime detector object
+ * @return {Coverage*}           Pointer to the coverage report
+ */
+EMSCRIPTEN_KEEPALIVE Coverage* getCoverage(AnytimeDetector* ad) {
+	return &ad->coverage;
+}
+
+/**
+ * Construct a tracker for a video stream of fixed frame size
+ * @param  {CascadeClassifier*} cc       Pointer to a cascade classifier object
+ * @param  {Int}                w        Width of the frames to be processed
+ * @param  {Int}                h        Height of the frames to be processed
+ * @param  {Float}              step     Detector scale step to apply
+ * @param  {Float}              delta    Detector sweep delta to apply
+ * @param  {Int}                interval A full scan runs every interval frames
+ * @return {Tracker*}                    A pointer to a new tracker object
+ */
+EMSCRIPTEN_KEEPALIVE Tracker* createTracker(CascadeClassifier* cc, int w, int h, float step, float delta, int interval) {
+	return new Tracker(*cc, w, h, step, delta, interval);
+}
+
+/**
+ * Destroy a tracker object
+ * @param {Tracker*} tr Pointer to the tracker to destroy
+ */
+EMSCRIPTEN_KEEPALIVE void destroyTracker(Tracker* tr) {
+	delete tr;
+}
+
+/**
+ * Gate a tracker's full scans on motion, for static cameras
+ * Scheduled full scans then only sweep the blocks that moved since the last scan plus tracked regions
+ * @param {Tracker*} tr        Pointer to a tracker object
+ * @param {Int}      blockSize Width and height of the blocks that motion is measured over (0 disables gating)
+ * @param {Float}    thresh    Minimum change in a block's mean or standard deviation luma that counts as motion
+ * @param {Int}      refresh   Number of frames between true full scans
+ */
+EMSCRIPTEN_KEEPALIVE void setMotionGate(Tracker* tr, int blockSize, float thresh, int refresh) {
+	tr->setMotionGate(blockSize, thresh, refresh);
+}
+
+/**
+ * Get the number of blocks that moved in a tracker's most recent frame
+ * @param  {Tracker*} tr Pointer to a tracker object
+ * @return {Int}         Moved block count
+ */
+EMSCRIPTEN_KEEPALIVE int getMovedBlocks(Tracker* tr) {
+	return tr->movedBlocks;
+}
+
+/**
+ * Write a tracker's tracks that were matched in its most recent frame to a buffer owned by the caller
+ * The buffer holds a header of two 32-bit elements [count, overflow] followed by capacity track records [x, y, s, id]
+ * @param  {Tracker*} tr       Pointer to a tracker object
+ * @param  {Int*}     out      Pointer to the output buffer, at least 2 + capacity * 4 elements long
+ * @param  {Int}      capacity Maximum number of track records the output buffer can hold
+ * @return {Int}               Number of tracks, which is more than capacity on overflow
+ */
+EMSCRIPTEN_KEEPALIVE int readTracks(Tracker* tr, int* out, int capacity) {
+	int count = 0;
+	for (int i = 0; i < tr->tracks.size(); i += 1) {
+		if (tr->tracks[i].misses != 0) continue;
+		if (count < capacity) {
+			int* record = out + 2 + count * 4;
+			record[0] = tr->tracks[i].box[0];
+			record[1] = tr->tracks[i].box[1];
+			record[2] = tr->tracks[i].box[2];
+			record[3] = tr->tracks[i].id;
 		}
-		cc->scale(step);
+		count += 1;
 	}
+	out[0] = std::min(count, std::max(0, capacity));
+	out[1] = count > out[0];
+	return count;
+}
 
-	if (pp) roi = nonMaxSuppression(roi, othresh, nthresh);
+/**
+ * Use a tracker to detect and track objects in the next frame of a video stream
+ * The tracks are written as for readTracks. On overflow, call readTracks with a larger buffer rather than tracking
+ * the frame again
+ * @param  {Tracker*}       tr       Pointer to a tracker object
+ * @param  {Unsigned char*} inputBuf Pointer to an HTML5 ImageData buffer
+ * @param  {Int}            pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}          othresh  Overlap threshold for post processing
+ * @param  {Float}          nthresh  Neighbor threshold for post processing
+ * @param  {Float}          minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @param  {Int*}           out      Pointer to the output buffer, at least 2 + capacity * 4 elements long
+ * @param  {Int}            capacity Maximum number of track records the output buffer can hold
+ * @return {Int}                     Number of tracks, which is more than capacity on overflow
+ */
+EMSCRIPTEN_KEEPALIVE int track(Tracker* tr, unsigned char inputBuf[], int pp, float othresh, int nthresh, float minsd, 
+                               int* out, int capacity) {
+	auto& roi = tr->detect(inputBuf, minsd);
+	tr->update(tr->post.run(roi, pp, othresh, nthresh));
+	return readTracks(tr, out, capacity);
+}
 
-	// We return a 1D array on the heap with its length stashed as the first element
-	int blen = roi.size() * 3 + 1;
-	uint16_t* boxes = new uint16_t[blen];
-	boxes[0] = blen;
-	for (int i = 0, j = 1; i < roi.size(); i += 1, j += 3) {
-		boxes[j] = roi[i][0];
-		boxes[j + 1] = roi[i][1];
-		boxes[j + 2] = roi[i][2];
+/**
+ * Get the number of subwindows considered by the most recent detection
+ * @return {Int} Subwindow count
+ */
+EMSCRIPTEN_KEEPALIVE int getWindowCount() {
+	return windowCount;
+}
+
+/**
+ * Get the number of subwindows rejected by the variance floor during the most recent detection
+ * @return {Int} Rejected subwindow count
+ */
+EMSCRIPTEN_KEEPALIVE int getRejectedCount() {
+	return rejectedCount;
+}
+
+/**
+ * Check whether this build counts heap allocations
+ * Allocation counting is compiled in by defining WASMFACE_COUNT_ALLOCS
+ * @return {Int} 1 if allocations are counted, 0 if not
+ */
+EMSCRIPTEN_KEEPALIVE int isCountingAllocs() {
+	return countingAllocs();
+}
+
+/**
+ * Zero the heap allocation counts of every phase
+ */
+EMSCRIPTEN_KEEPALIVE void resetAllocCounts() {
+	resetAllocCounters();
+}
+
+/**
+ * Get the number of heap allocations made during a phase of detection since the counts were last reset
+ * @param  {Int} phase 0 for other, 1 for grayscale, 2 for integral, 3 for sweep, 4 for post processing, 5 for output
+ * @return {Int}       Allocation count, always 0 unless allocations are counted
+ */
+EMSCRIPTEN_KEEPALIVE int getAllocCount(int phase) {
+	return countedAllocs(phase);
+}
+
+/**
+ * Get the number of bytes allocated from the heap during a phase of detection since the counts were last reset
+ * @param  {Int}    phase 0 for other, 1 for grayscale, 2 for integral, 3 for sweep, 4 for post processing, 5 for output
+ * @return {Double}       Allocated bytes, always 0 unless allocations are counted
+ */
+EMSCRIPTEN_KEEPALIVE double getAllocBytes(int phase) {
+	return countedBytes(phase);
+}
+
+/**
+ * Count the heap allocations made by a detector session in the steady state
+ * Detects once to let the session's buffers grow to fit the frame, then counts the allocations made by detecting
+ * the same frame again, which should be none. The per-phase counts are left for getAllocCount and getAllocBytes
+ * @param  {Detector*}      dt       Pointer to a detector object
+ * @param  {Unsigned char*} inputBuf Pointer to an HTML5 ImageData buffer
+ * @param  {Int}            pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Float}          othresh  Overlap threshold for post processing
+ * @param  {Float}          nthresh  Neighbor threshold for post processing
+ * @param  {Float}          minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @param  {Int}            mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @param  {Int*}           out      Pointer to the output buffer, at least 2 + capacity * 7 elements long
+ * @param  {Int}            capacity Maximum number of detection records the output buffer can hold
+ * @return {Int}                     Allocations made by the second detection, or -1 if allocations are not counted
+ */
+EMSCRIPTEN_KEEPALIVE int countSteadyStateAllocs(Detector* dt, unsigned char inputBuf[], int pp, float othresh, int nthresh, 
+                                                float minsd, int mindepth, int* out, int capacity) {
+	if (!countingAllocs()) return -1;
+	detectWith(dt, inputBuf, pp, othresh, nthresh, minsd, mindepth, out, capacity);
+	resetAllocCounters();
+	detectWith(dt, inputBuf, pp, othresh, nthresh, minsd, mindepth, out, capacity);
+	return countedAllocsTotal();
+}
+
+#ifdef WASMFACE_COUNT_ALLOCS
+/**
+ * Check that steady-state detection makes no heap allocations
+ * Runs a small synthetic cascade over a synthetic frame with each kind of post processing, for a detector session,
+ * an anytime detector and a tracker, and reports the allocations made in each phase of any detector session run that
+ * allocates
+ * @return {Int} 0 if no run allocates, 1 otherwise
+ */
+EMSCRIPTEN_KEEPALIVE int checkZeroAllocs() {
+	const char* phases[ALLOC_PHASES] = {"other", "grayscale", "integral", "sweep", "post processing", "output"};
+	int w = 160;
+	int h = 120;
+
+	// A one stage cascade that accepts about half of all subwindows, so post processing has plenty to merge
+	StrongClassifier strongClassifier;
+	WeakClassifier weakClassifier;
+	weakClassifier.haarlike = Haarlike(4, 4, 8, 16, 1);
+	weakClassifier.threshold = 0;
+	weakClassifier.polarity = 1;
+	strongClassifier.add(weakClassifier, 1);
+	CascadeClassifier cc(24, {strongClassifier});
+
+	std::vector<unsigned char> frame(w * h * 4);
+	unsigned int seed = 1;
+	for (int i = 0; i < frame.size(); i += 1) {
+		seed = seed * 1103515245 + 12345;
+		frame[i] = (seed >> 16) & 255;
 	}
-	
-	delete cc;
-	return boxes;
+
+	int failed = 0;
+	int capacity = 1024;
+	std::vector<int> out(2 + capacity * 7);
+	Detector detector(cc, w, h, 1.5, 2);
+	for (int pp = 0; pp <= 2; pp += 1) {
+		int allocs = countSteadyStateAllocs(&detector, frame.data(), pp, 0.3, 0, 0, 0, out.data(), capacity);
+		std::printf("Steady-state allocations with pp %d: %d\n", pp, allocs);
+		if (allocs == 0) continue;
+		failed = 1;
+		for (int i = 0; i < ALLOC_PHASES; i += 1) {
+			std::printf("  %s: %d allocations, %lld bytes\n", phases[i], countedAllocs(i), countedBytes(i));
+		}
+	}
+
+	// The anytime detector rescans around its previous boxes, so the first two frames let both sweeps grow their buffers
+	AnytimeDetector anytime(cc, w, h, 1.5, 2);
+	for (int pp = 0; pp <= 2; pp += 1) {
+		for (int i = 0; i < 2; i += 1) detectAnytime(&anytime, frame.data(), 1e9, pp, 0.3, 0, 0, out.data(), capacity);
+		resetAllocCounters();
+		detectAnytime(&anytime, frame.data(), 1e9, pp, 0.3, 0, 0, out.data(), capacity);
+		int allocs = countedAllocsTotal();
+		std::printf("Steady-state anytime allocations with pp %d: %d\n", pp, allocs);
+		if (allocs != 0) failed = 1;
+	}
+
+	// Full scans and tracked-region scans alternate, so warm up over whole intervals and count a whole interval
+	int interval = 3;
+	Tracker tracker(cc, w, h, 1.5, 2, interval);
+	for (int pp = 0; pp <= 2; pp += 1) {
+		for (int i = 0; i < interval * 2; i += 1) track(&tracker, frame.data(), pp, 0.3, 0, 0, out.data(), capacity);
+		resetAllocCounters();
+		for (int i = 0; i < interval; i += 1) track(&tracker, frame.data(), pp, 0.3, 0, 0, out.data(), capacity);
+		int allocs = countedAllocsTotal();
+		std::printf("Steady-state tracking allocations with pp %d: %d\n", pp, allocs);
+		if (allocs != 0) failed = 1;
+	}
+	return failed;
 }
+#endif
 
+#ifdef __EMSCRIPTEN__
 /**
  * Main function
+ * Builds that count allocations also check that steady-state detection makes none, and fail if it does. Native
+ * builds are libraries and leave main to the program, which can call checkZeroAllocs itself
  * @return {Int}
  */
 int main() {
-	std::cout << "Made with Wasmface\n";
+#ifndef WASMFACE_SLIM
+	std::printf("Made with Wasmface\n");
+#endif
+#ifdef WASMFACE_COUNT_ALLOCS
+	return checkZeroAllocs();
+#else
 	return 0;
+#endif
 }
+#endif
 
 #ifdef __cplusplus
 }
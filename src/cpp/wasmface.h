@@ -1,19 +1,132 @@
 #pragma once
 
+#include <stdint.h>
+
+// Emscripten builds export these functions to JavaScript. Native builds export them from a static or shared library,
+// and this header can be included from C, where the objects are opaque
+#ifdef __EMSCRIPTEN__
 #include <emscripten/emscripten.h>
+#elif defined(__GNUC__)
+#define EMSCRIPTEN_KEEPALIVE __attribute__((used, visibility("default")))
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+#include "worker-threads.h"
 
 #ifdef __cplusplus
+#include <vector>
+#include <array>
+
 extern "C" {
-#endif
 
 class CascadeClassifier;
+class AnytimeDetector;
+struct Coverage;
+struct Detection;
+class Detector;
+class MultiDetector;
+class BatchDetector;
+struct ImageDescriptor;
+class StreamScheduler;
+struct StreamStats;
+class Tracker;
+#else
+typedef struct CascadeClassifier CascadeClassifier;
+typedef struct AnytimeDetector AnytimeDetector;
+typedef struct Coverage Coverage;
+typedef struct Detector Detector;
+typedef struct MultiDetector MultiDetector;
+typedef struct BatchDetector BatchDetector;
+typedef struct ImageDescriptor ImageDescriptor;
+typedef struct StreamScheduler StreamScheduler;
+typedef struct StreamStats StreamStats;
+typedef struct Tracker Tracker;
+#endif
+typedef int (*CompiledCascade)(const float* window, float mean, float invsd, float* margin);
 
-bool compareDereferencedPtrs(int* a, int* b);
+#ifdef __cplusplus
 std::vector<std::array<int, 3>> nonMaxSuppression(std::vector<std::array<int, 3>>& boxes, float thresh, int nthresh);
+std::vector<std::array<int, 4>> groupDetections(std::vector<std::array<int, 3>>& boxes, float thresh, int nthresh);
+std::vector<std::array<int, 3>> postProcess(std::vector<std::array<int, 3>>& boxes, int pp, float othresh, int nthresh);
+uint16_t* packBoxes(std::vector<std::array<int, 3>>& roi);
+int* packDetections(std::vector<Detection>& found);
+int writeDetections(std::vector<Detection>& found, int* out, int capacity);
+#endif
+EMSCRIPTEN_KEEPALIVE int suppressNonMaxima(int boxes[], int count, float thresh, int nthresh, int out[]);
+EMSCRIPTEN_KEEPALIVE void destroyBoxes(uint16_t* boxes);
+EMSCRIPTEN_KEEPALIVE void destroyDetections(int* detections);
+#ifndef WASMFACE_SLIM
 EMSCRIPTEN_KEEPALIVE CascadeClassifier* create(char model[]);
+#endif
+EMSCRIPTEN_KEEPALIVE CascadeClassifier* createFromBinary(unsigned char bytes[], int size);
+EMSCRIPTEN_KEEPALIVE CascadeClassifier* createFromBinaryPrefix(unsigned char bytes[], int size);
+EMSCRIPTEN_KEEPALIVE int extendFromBinary(CascadeClassifier* cc, unsigned char bytes[], int size);
+EMSCRIPTEN_KEEPALIVE int getAvailableStages(unsigned char bytes[], int size);
+EMSCRIPTEN_KEEPALIVE int getStageCount(CascadeClassifier* cc);
+#ifndef __EMSCRIPTEN__
+EMSCRIPTEN_KEEPALIVE CascadeClassifier* createFromFile(char path[]);
+#endif
 EMSCRIPTEN_KEEPALIVE void destroy(CascadeClassifier* cc);
 EMSCRIPTEN_KEEPALIVE uint16_t* detect(unsigned char inputBuf[], int w, int h, CascadeClassifier* cco, 
-                                      float step, float delta, bool pp, float othresh, int nthresh);
+                                      float step, float delta, int pp, float othresh, int nthresh, float minsd);
+EMSCRIPTEN_KEEPALIVE int* detectScored(unsigned char inputBuf[], int w, int h, CascadeClassifier* cco, float step, 
+                                       float delta, int pp, float othresh, int nthresh, float minsd, int mindepth);
+EMSCRIPTEN_KEEPALIVE int detectInto(unsigned char inputBuf[], int w, int h, CascadeClassifier* cco, float step, float delta, 
+                                    int pp, float othresh, int nthresh, float minsd, int mindepth, int* out, int capacity);
+EMSCRIPTEN_KEEPALIVE Detector* createDetector(CascadeClassifier* cc, int w, int h, float step, float delta);
+EMSCRIPTEN_KEEPALIVE void destroyDetector(Detector* dt);
+EMSCRIPTEN_KEEPALIVE int detectWith(Detector* dt, unsigned char inputBuf[], int pp, float othresh, int nthresh, 
+                                    float minsd, int mindepth, int* out, int capacity);
+EMSCRIPTEN_KEEPALIVE void tuneDetector(Detector* dt, int maxStages, float offsets[], int count);
+EMSCRIPTEN_KEEPALIVE double getPhaseTime(Detector* dt, int phase);
+EMSCRIPTEN_KEEPALIVE int getDetectorGeneration(Detector* dt);
+EMSCRIPTEN_KEEPALIVE int getDetectorScales(Detector* dt);
+EMSCRIPTEN_KEEPALIVE int getIntegralStride(Detector* dt);
+EMSCRIPTEN_KEEPALIVE int exportScale(Detector* dt, int scale, unsigned char out[], int capacity);
+EMSCRIPTEN_KEEPALIVE int attachCompiledScale(Detector* dt, int generation, int scale, CompiledCascade fn);
+EMSCRIPTEN_KEEPALIVE void getDetectorKey(Detector* dt, uint32_t out[]);
+EMSCRIPTEN_KEEPALIVE MultiDetector* createMultiDetector(CascadeClassifier** models, int count, int w, int h, float step, float delta);
+EMSCRIPTEN_KEEPALIVE void destroyMultiDetector(MultiDetector* md);
+EMSCRIPTEN_KEEPALIVE int detectMulti(MultiDetector* md, unsigned char inputBuf[], int pp, float othresh, int nthresh, 
+                                     float minsd, int mindepth, int* out, int capacity);
+EMSCRIPTEN_KEEPALIVE BatchDetector* createBatchDetector(CascadeClassifier* cc, float step, float delta, int threads);
+EMSCRIPTEN_KEEPALIVE void destroyBatchDetector(BatchDetector* bd);
+EMSCRIPTEN_KEEPALIVE int detectBatch(BatchDetector* bd, ImageDescriptor* images, int count, int pp, float othresh, 
+                                     int nthresh, float minsd, int mindepth, int* out, int capacity);
+#ifdef WASMFACE_THREADS
+EMSCRIPTEN_KEEPALIVE StreamScheduler* createScheduler(int workers);
+EMSCRIPTEN_KEEPALIVE void destroyScheduler(StreamScheduler* sch);
+EMSCRIPTEN_KEEPALIVE int addStream(StreamScheduler* sch, CascadeClassifier* cc, int w, int h, float step, float delta, 
+                                   int pp, float othresh, int nthresh, float minsd, int mindepth, float target);
+EMSCRIPTEN_KEEPALIVE int submitFrame(StreamScheduler* sch, int stream, unsigned char inputBuf[]);
+EMSCRIPTEN_KEEPALIVE int readStream(StreamScheduler* sch, int stream, int* out, int capacity);
+EMSCRIPTEN_KEEPALIVE void getStreamStats(StreamScheduler* sch, int stream, StreamStats* out);
+#endif
+EMSCRIPTEN_KEEPALIVE AnytimeDetector* createAnytime(CascadeClassifier* cc, int w, int h, float step, float delta);
+EMSCRIPTEN_KEEPALIVE void destroyAnytime(AnytimeDetector* ad);
+EMSCRIPTEN_KEEPALIVE int readAnytime(AnytimeDetector* ad, int* out, int capacity);
+EMSCRIPTEN_KEEPALIVE int detectAnytime(AnytimeDetector* ad, unsigned char inputBuf[], float budget, int pp, float othresh, 
+                                       int nthresh, float minsd, int* out, int capacity);
+EMSCRIPTEN_KEEPALIVE Coverage* getCoverage(AnytimeDetector* ad);
+EMSCRIPTEN_KEEPALIVE Tracker* createTracker(CascadeClassifier* cc, int w, int h, float step, float delta, int interval);
+EMSCRIPTEN_KEEPALIVE void destroyTracker(Tracker* tr);
+EMSCRIPTEN_KEEPALIVE void setMotionGate(Tracker* tr, int blockSize, float thresh, int refresh);
+EMSCRIPTEN_KEEPALIVE int getMovedBlocks(Tracker* tr);
+EMSCRIPTEN_KEEPALIVE int readTracks(Tracker* tr, int* out, int capacity);
+EMSCRIPTEN_KEEPALIVE int track(Tracker* tr, unsigned char inputBuf[], int pp, float othresh, int nthresh, float minsd, 
+                               int* out, int capacity);
+EMSCRIPTEN_KEEPALIVE int isCountingAllocs();
+EMSCRIPTEN_KEEPALIVE void resetAllocCounts();
+EMSCRIPTEN_KEEPALIVE int getAllocCount(int phase);
+EMSCRIPTEN_KEEPALIVE double getAllocBytes(int phase);
+EMSCRIPTEN_KEEPALIVE int countSteadyStateAllocs(Detector* dt, unsigned char inputBuf[], int pp, float othresh, int nthresh, 
+                                                float minsd, int mindepth, int* out, int capacity);
+EMSCRIPTEN_KEEPALIVE int getWindowCount();
+EMSCRIPTEN_KEEPALIVE int getRejectedCount();
+#ifdef WASMFACE_COUNT_ALLOCS
+EMSCRIPTEN_KEEPALIVE int checkZeroAllocs();
+#endif
 
 #ifdef __cplusplus
 }
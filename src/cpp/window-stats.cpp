@@ -0,0 +1,124 @@
+#include <vector>
+#include <limits>
+#include <cmath>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+#include "window-stats.h"
+#include "integral-image.h"
+
+/**
+ * Constructor
+ */
+WindowStats::WindowStats() {
+	this->cols = 0;
+	this->rows = 0;
+}
+
+/**
+ * Compute the mean and inverse standard deviation of every subwindow in one detector sweep
+ * Subwindow origins run from (x0, y0) in increments of stride, stopping before (x1, y1)
+ * Results are stored row-major, one entry per subwindow, in sweep order
+ * Subwindows with a standard deviation below minsd are marked as rejected
+ * Subwindows with no variance get an inverse standard deviation of 1, leaving their features unnormalized
+ * @param  {IntegralImage} integral        Integral image of the input
+ * @param  {IntegralImage} integralSquared Integral image of the squared input
+ * @param  {Int}           s               Subwindow size
+ * @param  {Int}           x0              X offset of the first subwindow
+ * @param  {Int}           y0              Y offset of the first subwindow
+ * @param  {Int}           x1              Subwindow x offsets must be less than this
+ * @param  {Int}           y1              Subwindow y offsets must be less than this
+ * @param  {Int}           stride          Distance between neighboring subwindows
+ * @param  {Float}         minsd           Minimum standard deviation required to pass (0 disables the floor)
+ * @return {Int}                           Number of rejected subwindows
+ */
+int WindowStats::compute(IntegralImage& integral, IntegralImage& integralSquared, int s, int x0, int y0, int x1, int y1, int stride, float minsd) {
+	this->cols = x1 > x0 ? (x1 - x0 + stride - 1) / stride : 0;
+	this->rows = y1 > y0 ? (y1 - y0 + stride - 1) / stride : 0;
+
+	int len = this->cols * this->rows;
+	this->sum.resize(len);
+	this->squaredSum.resize(len);
+	this->mean.resize(len);
+	this->invsd.resize(len);
+	this->pass.resize(len);
+
+	// Gather the subwindow sums so the statistics below run over contiguous memory
+	for (int y = y0, i = 0; y < y1; y += stride) {
+		const float* top = &integral.data[y * integral.stride];
+		const float* bottom = &integral.data[(y + s) * integral.stride];
+		const float* topSquared = &integralSquared.data[y * integralSquared.stride];
+		const float* bottomSquared = &integralSquared.data[(y + s) * integralSquared.stride];
+		for (int x = x0; x < x1; x += stride, i += 1) {
+			this->sum[i] = bottom[x + s] + top[x] - (top[x + s] + bottom[x]);
+			this->squaredSum[i] = bottomSquared[x + s] + topSquared[x] - (topSquared[x + s] + bottomSquared[x]);
+		}
+	}
+
+	// Comparing variances against the squared floor avoids a sqrt for rejected subwindows
+	float area = float(s) * float(s);
+	float floor = minsd > 0 ? minsd * minsd : -std::numeric_limits<float>::infinity();
+	int passed = 0;
+	int i = 0;
+
+#if defined(__SSE__)
+	__m128 areaV = _mm_set1_ps(area);
+	__m128 floorV = _mm_set1_ps(floor);
+	__m128 zeroV = _mm_setzero_ps();
+	__m128 oneV = _mm_set1_ps(1.0f);
+	for (; i + 4 <= len; i += 4) {
+		__m128 m = _mm_div_ps(_mm_loadu_ps(&this->sum[i]), areaV);
+		__m128 v = _mm_sub_ps(_mm_div_ps(_mm_loadu_ps(&this->squaredSum[i]), areaV), _mm_mul_ps(m, m));
+
+		// An exact reciprocal of an exact sqrt, like the scalar tail and the WebAssembly path, so that a subwindow's
+		// inverse standard deviation doesn't depend on its lane or on the target, which rsqrt can't promise
+		__m128 r = _mm_div_ps(oneV, _mm_sqrt_ps(v));
+		__m128 positive = _mm_cmpgt_ps(v, zeroV);
+		r = _mm_or_ps(_mm_and_ps(positive, r), _mm_andnot_ps(positive, oneV));
+
+		_mm_storeu_ps(&this->mean[i], m);
+		_mm_storeu_ps(&this->invsd[i], r);
+		int bits = _mm_movemask_ps(_mm_cmpge_ps(v, floorV));
+		for (int j = 0; j < 4; j += 1) {
+			this->pass[i + j] = (bits >> j) & 1;
+			passed += this->pass[i + j];
+		}
+	}
+#elif defined(__wasm_simd128__)
+	v128_t areaV = wasm_f32x4_splat(area);
+	v128_t floorV = wasm_f32x4_splat(floor);
+	v128_t zeroV = wasm_f32x4_splat(0.0f);
+	v128_t oneV = wasm_f32x4_splat(1.0f);
+	for (; i + 4 <= len; i += 4) {
+		v128_t m = wasm_f32x4_div(wasm_v128_load(&this->sum[i]), areaV);
+		v128_t v = wasm_f32x4_sub(wasm_f32x4_div(wasm_v128_load(&this->squaredSum[i]), areaV), wasm_f32x4_mul(m, m));
+
+		// The exact reciprocal of an exact sqrt, as in the SSE path and the scalar tail
+		v128_t r = wasm_f32x4_div(oneV, wasm_f32x4_sqrt(v));
+		r = wasm_v128_bitselect(r, oneV, wasm_f32x4_gt(v, zeroV));
+
+		wasm_v128_store(&this->mean[i], m);
+		wasm_v128_store(&this->invsd[i], r);
+		int ok[4];
+		wasm_v128_store(ok, wasm_f32x4_ge(v, floorV));
+		for (int j = 0; j < 4; j += 1) {
+			this->pass[i + j] = ok[j] != 0;
+			passed += this->pass[i + j];
+		}
+	}
+#endif
+
+	for (; i < len; i += 1) {
+		float m = this->sum[i] / area;
+		float v = this->squaredSum[i] / area - m * m;
+		this->mean[i] = m;
+		this->invsd[i] = v > 0 ? 1.0f / std::sqrt(v) : 1.0f;
+		this->pass[i] = v >= floor;
+		passed += this->pass[i];
+	}
+	return len - passed;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+
+#include "integral-image.h"
+
+class WindowStats {
+	public:
+		WindowStats();
+		int compute(IntegralImage& integral, IntegralImage& integralSquared, int s, int x0, int y0, int x1, int y1, int stride, float minsd);
+		int cols;
+		int rows;
+		std::vector<float> sum;
+		std::vector<float> squaredSum;
+		std::vector<float> mean;
+		std::vector<float> invsd;
+		std::vector<unsigned char> pass;
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+// Worker threads are available natively and in emscripten builds with -pthread
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define WASMFACE_THREADS 1
+#ifdef __cplusplus
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+#endif
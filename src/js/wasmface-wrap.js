@@ -1,49 +1,1022 @@
 /**
  * Constructor
- * @param {JSON Object} model A wasmface cascade classifier model
+ * A binary model is copied to the heap as is and read without parsing, so it loads much faster than a JSON model.
+ * Slim builds load binary models only
+ * @param {JSON Object|ArrayBuffer} model A wasmface cascade classifier model, as JSON or in the binary model format
  */
 function Wasmface(model) {
-	const strptr = Module.allocate(intArrayFromString(JSON.stringify(model)), "i8", 0);
-	this.ptr = Module.ccall("create", "number", ["number"], [strptr]);
-	Module._free(strptr);
+	if (model instanceof ArrayBuffer || ArrayBuffer.isView(model)) {
+		const bytes = model instanceof ArrayBuffer ? new Uint8Array(model) : new Uint8Array(model.buffer, model.byteOffset, model.byteLength);
+		const ptr = Module._malloc(bytes.length);
+		Module.HEAPU8.set(bytes, ptr);
+		this.ptr = Module.ccall("createFromBinary", "number", ["number", "number"], [ptr, bytes.length]);
+		Module._free(ptr);
+		if (!this.ptr) throw new Error("Wasmface: malformed binary model or unsupported format version");
+	} else {
+		if (!Module._create) throw new Error("Wasmface: this is a slim build, which loads binary models only");
+		const strptr = Module.allocate(intArrayFromString(JSON.stringify(model)), "i8", 0);
+		this.ptr = Module.ccall("create", "number", ["number"], [strptr]);
+		Module._free(strptr);
+		if (!this.ptr) throw new Error("Wasmface: malformed JSON model");
+	}
+	this.timing = {upload: 0, detect: 0, read: 0};
+}
+
+/**
+ * Load a binary model progressively
+ * Resolves as soon as the first minStages stages have arrived, with a Wasmface object that detects with those stages
+ * while the rest of the model streams in. Every stage that arrives is added to the cascade, and detection switches
+ * to it on the next frame without any action from the caller. stages and complete track progress
+ * @param  {String}   url       URL of a binary model
+ * @param  {Number}   minStages Number of stages to wait for before resolving
+ * @param  {Function} onStage   Called with the Wasmface object and its stage count each time stages are added
+ * @return {Promise}            Resolves to a Wasmface object
+ */
+Wasmface.progressive = function(url, minStages = 1, onStage = null) {
+	return fetch(url).then(response => new Promise((resolve, reject) => {
+		const reader = response.body.getReader();
+		let bytes = new Uint8Array(0);
+		let wasmface = null;
+
+		// The whole prefix is copied each time, which is cheap next to a network round trip for models this small
+		const grow = () => {
+			const ptr = Module._malloc(bytes.length);
+			Module.HEAPU8.set(bytes, ptr);
+			if (!wasmface) {
+				const available = Module.ccall("getAvailableStages", "number", ["number", "number"], [ptr, bytes.length]);
+				if (available >= minStages) {
+					wasmface = Object.create(Wasmface.prototype);
+					wasmface.ptr = Module.ccall("createFromBinaryPrefix", "number", ["number", "number"], [ptr, bytes.length]);
+					wasmface.timing = {upload: 0, detect: 0, read: 0};
+					wasmface.stages = Module.ccall("getStageCount", "number", ["number"], [wasmface.ptr]);
+					wasmface.complete = false;
+					resolve(wasmface);
+					if (onStage) onStage(wasmface, wasmface.stages);
+				}
+			} else {
+				const stages = Module.ccall("extendFromBinary", "number", ["number", "number", "number"], [wasmface.ptr, ptr, bytes.length]);
+				if (stages > wasmface.stages) {
+					wasmface.stages = stages;
+					if (onStage) onStage(wasmface, stages);
+				}
+			}
+			Module._free(ptr);
+		};
+
+		const pump = () => reader.read().then(({done, value}) => {
+			if (value) {
+				const next = new Uint8Array(bytes.length + value.length);
+				next.set(bytes);
+				next.set(value, bytes.length);
+				bytes = next;
+				grow();
+			}
+			if (!done) return pump();
+			if (!wasmface) {
+				// A model with fewer stages than minStages runs with all of them
+				minStages = 1;
+				if (bytes.length) grow();
+				if (!wasmface) return reject(new Error("Wasmface: malformed binary model or too few stages"));
+			}
+			wasmface.complete = true;
+		}).catch(reject);
+		pump();
+	}));
+}
+
+/**
+ * Read an array of bounding box geometry from the heap
+ * @param  {Number} ptr Index of the array in HEAPU16
+ * @return {Array}      2D array of 1:1 aspect ratio bounding boxes [x, y, s] where s = width and height
+ */
+function readBoxes(ptr) {
+	const len = Module.HEAPU16[ptr];
+	const boxes = [];
+	for (let i = 1; i < len; i += 3) {
+		const box = [Module.HEAPU16[ptr + i], Module.HEAPU16[ptr + i + 1], Module.HEAPU16[ptr + i + 2]];
+		boxes.push(box);
+	}
+	return boxes;
+}
+
+/**
+ * Read an array of scored detection records from the heap
+ * @param  {Number} ptr   Index of the first record in HEAP32
+ * @param  {Number} count Number of records to read
+ * @return {Array}        Array of detections {x, y, s, depth, margin, neighbors, label} where s = width and height
+ */
+function readDetections(ptr, count) {
+	const detections = [];
+	for (let i = 0, j = ptr; i < count; i += 1, j += 7) {
+		detections.push({
+			x: Module.HEAP32[j],
+			y: Module.HEAP32[j + 1],
+			s: Module.HEAP32[j + 2],
+			depth: Module.HEAP32[j + 3],
+			margin: Module.HEAPF32[j + 4],
+			neighbors: Module.HEAP32[j + 5],
+			label: Module.HEAP32[j + 6]
+		});
+	}
+	return detections;
+}
+
+/**
+ * Apply a depth limit and stage threshold offsets to a detector session
+ * @param {Number} ptr    Pointer to the detector session
+ * @param {Object} tuning {maxStages, offsets}
+ */
+function tuneDetector(ptr, tuning) {
+	const offsets = Module._malloc(Math.max(1, tuning.offsets.length) * Float32Array.BYTES_PER_ELEMENT);
+	Module.HEAPF32.set(tuning.offsets, offsets / Float32Array.BYTES_PER_ELEMENT);
+	Module.ccall("tuneDetector", null, ["number", "number", "number", "number"], [ptr, tuning.maxStages, offsets, tuning.offsets.length]);
+	Module._free(offsets);
+}
+
+/**
+ * Limit the number of cascade stages that detect, detectScored and detectView run, and shift stage thresholds
+ * The loaded model is left as is: the tuning is applied to the detector session's scaled copies of the cascade
+ * @param {Number} maxStages Number of stages to run (0 runs every stage)
+ * @param {Array}  offsets   Amount to add to each stage's threshold, by stage. Positive offsets reject more subwindows
+ */
+Wasmface.prototype.tune = function(maxStages = 0, offsets = []) {
+	this.tuning = {maxStages: maxStages, offsets: offsets};
+	if (this.detector) tuneDetector(this.detector.ptr, this.tuning);
+}
+
+/**
+ * Read a cascade classifier in the binary model format
+ * @param  {Uint8Array} bytes The model
+ * @return {Object}           {baseResolution, stages}, where each stage is {threshold, features} and each feature is
+ *                            {type, x, y, w, h, polarity, threshold, weight}
+ */
+function readBinaryModel(bytes) {
+	const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+	const stageCount = view.getUint32(12, true);
+	const stages = [];
+	for (let i = 0, s = 32, f = 32 + stageCount * 8; i < stageCount; i += 1, s += 8) {
+		const stage = {threshold: view.getFloat32(s, true), features: []};
+		for (let j = view.getUint32(s + 4, true); j > 0; j -= 1, f += 32) {
+			stage.features.push({
+				type: view.getInt32(f, true),
+				x: view.getInt32(f + 4, true),
+				y: view.getInt32(f + 8, true),
+				w: view.getInt32(f + 12, true),
+				h: view.getInt32(f + 16, true),
+				polarity: view.getInt32(f + 20, true),
+				threshold: view.getFloat32(f + 24, true),
+				weight: view.getFloat32(f + 28, true)
+			});
+		}
+		stages.push(stage);
+	}
+	return {baseResolution: view.getUint32(8, true), stages: stages};
+}
+
+/**
+ * Growable byte buffer for generating WebAssembly modules
+ */
+function WasmWriter() {
+	this.bytes = new Uint8Array(1 << 16);
+	this.view = new DataView(this.bytes.buffer);
+	this.length = 0;
+}
+
+/**
+ * Make room for more bytes
+ * @param {Number} n Number of bytes to make room for
+ */
+WasmWriter.prototype.reserve = function(n) {
+	if (this.length + n <= this.bytes.length) return;
+	const bytes = new Uint8Array(Math.max(this.bytes.length * 2, this.length + n));
+	bytes.set(this.bytes.subarray(0, this.length));
+	this.bytes = bytes;
+	this.view = new DataView(bytes.buffer);
+}
+
+/**
+ * Append bytes, such as an opcode and its immediates
+ * @param {...Number} codes The bytes
+ */
+WasmWriter.prototype.emit = function(...codes) {
+	this.reserve(codes.length);
+	for (let i = 0; i < codes.length; i += 1) this.bytes[this.length++] = codes[i];
+}
+
+/**
+ * Append an unsigned LEB128 integer
+ * @param {Number} n The integer
+ */
+WasmWriter.prototype.unsigned = function(n) {
+	this.reserve(5);
+	do {
+		let byte = n & 0x7f;
+		n >>>= 7;
+		if (n) byte |= 0x80;
+		this.bytes[this.length++] = byte;
+	} while (n);
+}
+
+/**
+ * Append an f32.const instruction
+ * @param {Number} v The constant, which is rounded to single precision
+ */
+WasmWriter.prototype.float = function(v) {
+	this.reserve(5);
+	this.bytes[this.length++] = 0x43;
+	this.view.setFloat32(this.length, v, true);
+	this.length += 4;
+}
+
+/**
+ * Append a name
+ * @param {String} s The name, in ASCII
+ */
+WasmWriter.prototype.name = function(s) {
+	this.unsigned(s.length);
+	for (let i = 0; i < s.length; i += 1) this.emit(s.charCodeAt(i));
+}
+
+/**
+ * Append the contents of another writer, prefixed with its length
+ * @param {WasmWriter} other The writer to append
+ */
+WasmWriter.prototype.append = function(other) {
+	this.unsigned(other.length);
+	this.reserve(other.length);
+	this.bytes.set(other.bytes.subarray(0, other.length), this.length);
+	this.length += other.length;
+}
+
+/**
+ * Append the code for one scaled cascade classifier
+ * The function takes (window, mean, invsd, margin) like a CompiledCascade and does exactly what
+ * CascadeClassifier::evaluate does, in the same single precision operations in the same order, so its results are
+ * bit for bit the interpreter's. Every rectangle corner is a load at a constant offset from window, and each weak
+ * classifier's feature type, polarity, threshold and weight are built into its code
+ * @param {WasmWriter} out    Where to append
+ * @param {Object}     model  The cascade classifier, as read by readBinaryModel
+ * @param {Number}     stride Stride of the integral images, in values per row
+ */
+function writeCascadeCode(out, model, stride) {
+	const load = (x, y) => {
+		out.emit(0x20, 0, 0x2a, 2);
+		out.unsigned((y * stride + x) * Float32Array.BYTES_PER_ELEMENT);
+	};
+
+	// getRectangleSum: bottom[w] + top[0] - (top[w] + bottom[0])
+	const rect = (x, y, w, h) => {
+		load(x + w, y + h);
+		load(x, y);
+		out.emit(0x92);
+		load(x + w, y);
+		load(x, y + h);
+		out.emit(0x92, 0x93);
+	};
+
+	for (let i = 0; i < model.stages.length; i += 1) {
+		const stage = model.stages[i];
+		out.float(0);
+		out.emit(0x21, 4);
+		for (const f of stage.features) {
+			out.emit(0x20, 4);
+			out.float(f.weight);
+			out.float(-f.weight);
+
+			// bSum - wSum, as in IntegralImage::computeFeature
+			if (f.type === 1) {
+				rect(f.x + f.w, f.y, f.w, f.h);
+				rect(f.x, f.y, f.w, f.h);
+			} else if (f.type === 2) {
+				rect(f.x + f.w, f.y, f.w, f.h);
+				rect(f.x, f.y, f.w, f.h);
+				rect(f.x + f.w * 2, f.y, f.w, f.h);
+				out.emit(0x92);
+			} else if (f.type === 3) {
+				rect(f.x, f.y + f.h, f.w, f.h);
+				rect(f.x, f.y, f.w, f.h);
+			} else if (f.type === 4) {
+				rect(f.x, f.y + f.h, f.w, f.h);
+				rect(f.x, f.y, f.w, f.h);
+				rect(f.x, f.y + f.h * 2, f.w, f.h);
+				out.emit(0x92);
+			} else {
+				rect(f.x + f.w, f.y, f.w, f.h);
+				rect(f.x, f.y + f.h, f.w, f.h);
+				out.emit(0x92);
+				rect(f.x, f.y, f.w, f.h);
+				rect(f.x + f.w, f.y + f.h, f.w, f.h);
+				out.emit(0x92);
+			}
+			out.emit(0x93);
+
+			// Post-normalization, as in StrongClassifier::score
+			if (f.type === 2 || f.type === 4) {
+				out.float(f.w * 3 * f.h);
+				out.emit(0x20, 1, 0x94);
+				out.float(3);
+				out.emit(0x95, 0x92);
+			}
+			out.emit(0x20, 2, 0x94);
+
+			// WeakClassifier::classify: f * polarity < threshold * polarity
+			if (f.polarity === 1) {
+				out.float(f.threshold);
+				out.emit(0x5d);
+			} else if (f.polarity === -1) {
+				out.float(f.threshold);
+				out.emit(0x5e);
+			} else {
+				out.float(f.polarity);
+				out.emit(0x94);
+				out.float(Math.fround(f.threshold * f.polarity));
+				out.emit(0x5d);
+			}
+			out.emit(0x1b, 0x92, 0x21, 4);
+		}
+
+		// Stop at the first stage whose score falls short of its threshold
+		out.emit(0x20, 4);
+		out.float(stage.threshold);
+		out.emit(0x93, 0x22, 5);
+		out.float(0);
+		out.emit(0x5d, 0x04, 0x40, 0x20, 3, 0x20, 5, 0x38, 2, 0, 0x41);
+		out.unsigned(i);
+		out.emit(0x0f, 0x0b);
+	}
+	out.emit(0x20, 3, 0x20, 5, 0x38, 2, 0, 0x41);
+	out.unsigned(model.stages.length);
+	out.emit(0x0b);
+}
+
+/**
+ * Generate a WebAssembly module with one function per scaled cascade classifier, exported as s0, s1, ...
+ * The module imports the memory the integral images live in as env.memory
+ * @param  {Array}      models The scaled cascade classifiers, as read by readBinaryModel
+ * @param  {Number}     stride Stride of the integral images, in values per row
+ * @param  {Boolean}    shared True if the memory is shared, as in threaded builds
+ * @return {Uint8Array}        The module
+ */
+function compileCascades(models, stride, shared) {
+	const out = new WasmWriter();
+	out.emit(0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00);
+
+	// One type, (i32 window, f32 mean, f32 invsd, i32 margin) -> i32 depth
+	out.emit(1, 9, 1, 0x60, 4, 0x7f, 0x7d, 0x7d, 0x7f, 1, 0x7f);
+
+	const imports = new WasmWriter();
+	imports.emit(1);
+	imports.name("env");
+	imports.name("memory");
+	imports.emit(0x02);
+	if (shared) imports.emit(0x03, 0, 0x80, 0x80, 0x04);
+	else imports.emit(0x00, 0);
+	out.emit(2);
+	out.append(imports);
+
+	const functions = new WasmWriter();
+	functions.unsigned(models.length);
+	for (let i = 0; i < models.length; i += 1) functions.emit(0);
+	out.emit(3);
+	out.append(functions);
+
+	const exports = new WasmWriter();
+	exports.unsigned(models.length);
+	for (let i = 0; i < models.length; i += 1) {
+		exports.name("s" + i);
+		exports.emit(0x00);
+		exports.unsigned(i);
+	}
+	out.emit(7);
+	out.append(exports);
+
+	// Two f32 locals, the running score and the margin
+	const code = new WasmWriter();
+	code.unsigned(models.length);
+	for (let i = 0; i < models.length; i += 1) {
+		const body = new WasmWriter();
+		body.emit(1, 2, 0x7d);
+		writeCascadeCode(body, models[i], stride);
+		code.append(body);
+	}
+	out.emit(10);
+	out.append(code);
+
+	return out.bytes.slice(0, out.length);
+}
+
+/**
+ * Instantiate a generated module from Cache Storage, or generate it and add it to the cache
+ * Without Cache Storage, as in insecure contexts, or if the cached module won't instantiate, the module is generated
+ * @param  {String}   name     Name of the cache
+ * @param  {String}   url      URL the module is cached under
+ * @param  {Function} generate Returns the module, or null if it can no longer be generated for this URL
+ * @param  {Object}   imports  The module's imports
+ * @return {Promise}           Resolves with the instance and module, or with null if generate returned null
+ */
+function instantiateCached(name, url, generate, imports) {
+	const instantiate = (cache) => {
+		const bytes = generate();
+		if (!bytes) return null;
+		if (cache) cache.put(url, new Response(bytes, {headers: {"Content-Type": "application/wasm"}})).catch(() => {});
+		return WebAssembly.instantiate(bytes, imports);
+	};
+	if (typeof caches === "undefined") return Promise.resolve(instantiate(null));
+	return caches.open(name).then(cache => cache.match(url).then(response => {
+		if (!response) return instantiate(cache);
+		return response.arrayBuffer().then(bytes => WebAssembly.instantiate(bytes, imports))
+			.catch(() => cache.delete(url).then(() => instantiate(cache)));
+	}), () => instantiate(null));
+}
+
+/**
+ * Compile a detector session's scaled cascade classifiers to WebAssembly and send its detection through them
+ * Compilation is asynchronous and the interpreter runs in the meantime. Code compiled for scales that have since
+ * been rebuilt is discarded, and a failure leaves the session on the interpreter. With a cache, code generated for
+ * the same model, frame width, scale step and tuning by the same build is reused, even across page loads
+ * @param  {Object}  session   The detector session, as kept by detectInto
+ * @param  {String}  cacheName Name of the cache to keep generated code in, or null for none
+ * @return {Promise}           Resolves when the code is attached, or rejects if it can't be compiled or attached
+ */
+function compileDetector(session, cacheName) {
+	const ptr = session.ptr;
+	const generation = Module.ccall("getDetectorGeneration", "number", ["number"], [ptr]);
+	const jit = {generation: generation, functions: [], failed: false};
+	session.jit = jit;
+
+	const memory = Module.wasmMemory || (Module.asm && Module.asm.memory) || (Module.wasmExports && Module.wasmExports.memory);
+	if (typeof WebAssembly === "undefined" || !memory || !Module.addFunction) {
+		jit.failed = true;
+		return Promise.reject(new Error("Wasmface: this build can't attach generated code, see the readme"));
+	}
+
+	const stride = Module.ccall("getIntegralStride", "number", ["number"], [ptr]);
+	const count = Module.ccall("getDetectorScales", "number", ["number"], [ptr]);
+	const shared = typeof SharedArrayBuffer !== "undefined" && memory.buffer instanceof SharedArrayBuffer;
+	const imports = {env: {memory: memory}};
+
+	// The scales are exported when the code is generated, which is skipped on a cache hit and may come after the
+	// scales have been rebuilt, in which case nothing is generated or cached and the next frame recompiles
+	const generate = () => {
+		if (session.destroyed || Module.ccall("getDetectorGeneration", "number", ["number"], [ptr]) !== generation) return null;
+		const exportTypes = ["number", "number", "number", "number"];
+		const models = [];
+		for (let i = 0; i < count; i += 1) {
+			const size = Module.ccall("exportScale", "number", exportTypes, [ptr, i, 0, 0]);
+			const buf = Module._malloc(size);
+			Module.ccall("exportScale", "number", exportTypes, [ptr, i, buf, size]);
+			models.push(readBinaryModel(Module.HEAPU8.slice(buf, buf + size)));
+			Module._free(buf);
+		}
+		return compileCascades(models, stride, shared);
+	};
+
+	let instantiated;
+	if (cacheName) {
+		const key = Module._malloc(2 * Int32Array.BYTES_PER_ELEMENT);
+		Module.ccall("getDetectorKey", null, ["number", "number"], [ptr, key]);
+		const hex = (i) => (Module.HEAP32[key / Int32Array.BYTES_PER_ELEMENT + i] >>> 0).toString(16).padStart(8, "0");
+		const url = "wasmface-jit/" + hex(1) + hex(0) + "-" + stride + (shared ? "-shared" : "") + ".wasm";
+		Module._free(key);
+		instantiated = instantiateCached(cacheName, url, generate, imports);
+	} else {
+		instantiated = WebAssembly.instantiate(generate(), imports);
+	}
+
+	const attachTypes = ["number", "number", "number", "number"];
+	return instantiated.catch(err => {
+		jit.failed = true;
+		throw err;
+	}).then(result => {
+		// The session was released, or started compiling again, or its scales were rebuilt, while this code compiled
+		if (!result || session.destroyed || session.jit !== jit) return;
+
+		// The scales were rebuilt since they were exported if the generation moved on, and the next frame recompiles
+		let attached = true;
+		let error = null;
+		try {
+			for (let i = 0; i < count && attached; i += 1) {
+				const fn = Module.addFunction(result.instance.exports["s" + i], "iiffi");
+				jit.functions.push(fn);
+				attached = Module.ccall("attachCompiledScale", "number", attachTypes, [ptr, generation, i, fn]) === 1;
+			}
+		} catch (err) {
+			error = err;
+		}
+		if (attached && !error) return;
+		for (let i = 0; i < jit.functions.length; i += 1) {
+			Module.ccall("attachCompiledScale", "number", attachTypes, [ptr, generation, i, 0]);
+			Module.removeFunction(jit.functions[i]);
+		}
+		jit.functions = [];
+		if (error) {
+			jit.failed = true;
+			throw error;
+		}
+	});
+}
+
+/**
+ * Release the generated code attached to a detector session
+ * @param {Object} session The detector session, as kept by detectInto
+ */
+function releaseDetector(session) {
+	session.destroyed = true;
+	if (session.jit) session.jit.functions.forEach(fn => Module.removeFunction(fn));
+	Module.ccall("destroyDetector", null, ["number"], [session.ptr]);
+}
+
+/**
+ * Compile the cascade classifier to WebAssembly for detect, detectScored and detectView
+ * Each detection session compiles its own scaled copies of the cascade, tuning included, with their features and
+ * thresholds built into the code. The first frames of a session run on the interpreter while compilation finishes,
+ * and the session recompiles whenever its scales are rebuilt, as when stages arrive or the tuning changes. If code
+ * can't be generated or compiled, detection stays on the interpreter. Results are the same either way
+ * @param {Boolean} enabled False goes back to the interpreter for new sessions
+ */
+Wasmface.prototype.jit = function(enabled = true) {
+	this.jitEnabled = enabled;
+}
+
+/**
+ * Keep the code jit generates in Cache Storage, so that sessions for a model, frame width, scale step and tuning
+ * seen before, on this page load or an earlier one, skip generating it and start on compiled code sooner
+ * Entries are keyed by everything the code is generated from, the build included, so stale code is never used.
+ * Delete the cache with caches.delete(name) to reclaim its space
+ * @param {String|Boolean} name Name of the cache, or false to stop caching for new sessions
+ */
+Wasmface.prototype.cache = function(name = "wasmface") {
+	this.cacheName = name || null;
+}
+
+/**
+ * Check whether the current detection session runs compiled code
+ * @return {Boolean} True if every scale of the session is compiled
+ */
+Wasmface.prototype.compiled = function() {
+	const d = this.detector;
+	if (!d || !d.jit || d.jit.failed) return false;
+	return Module.ccall("getDetectorGeneration", "number", ["number"], [d.ptr]) === d.jit.generation &&
+		d.jit.functions.length === Module.ccall("getDetectorScales", "number", ["number"], [d.ptr]);
 }
 
 /**
  * Manually deallocate the heap memory associated with a cascade classifier 
  */
 Wasmface.prototype.destroy = function() {
+	if (this.anytime) Module.ccall("destroyAnytime", null, ["number"], [this.anytime.ptr]);
+	if (this.tracker) Module.ccall("destroyTracker", null, ["number"], [this.tracker.ptr]);
+	if (this.detector) releaseDetector(this.detector);
+	if (this.multi) Module.ccall("destroyMultiDetector", null, ["number"], [this.multi.ptr]);
+	if (this.batch) {
+		Module.ccall("destroyBatchDetector", null, ["number"], [this.batch.ptr]);
+		Module._free(this.batch.input);
+		Module._free(this.batch.output);
+	}
+	if (this.output) Module._free(this.output.ptr);
+	if (this.input) Module._free(this.input.ptr);
 	Module.ccall("destroy", null, ["number"], [this.ptr]);
 }
 
+/**
+ * Reserve room for a number of detections in the output buffer that detect, detectScored and track write to
+ * The buffer is reused across calls and grows on its own when a frame overflows it
+ * @param {Number} capacity Number of detections to make room for
+ */
+Wasmface.prototype.reserve = function(capacity) {
+	if (this.output) Module._free(this.output.ptr);
+	const ptr = Module._malloc((2 + capacity * 7) * Int32Array.BYTES_PER_ELEMENT);
+	this.output = {ptr: ptr, capacity: capacity};
+}
+
+/**
+ * Copy the pixels of an HTML5 canvas into the input buffer
+ * The input buffer lives on the heap and is reused across calls, growing only when the canvas does
+ * @param  {Canvas context object} ctx 2D context for the canvas 
+ * @return {Number}                    Pointer to the input buffer
+ */
+Wasmface.prototype.upload = function(ctx) {
+	const start = performance.now();
+	const inputImgData = ctx.getImageData(0, 0, ctx.canvas.width, ctx.canvas.height);
+	const size = inputImgData.data.length;
+	if (!this.input || this.input.size < size) {
+		if (this.input) Module._free(this.input.ptr);
+		this.input = {ptr: Module._malloc(size), size: size};
+	}
+	Module.HEAPU8.set(inputImgData.data, this.input.ptr);
+	this.timing.upload = performance.now() - start;
+	return this.input.ptr;
+}
+
+const detectWithTypes = ["number", "number", "number", "number", "number", "number", "number", "number", "number"];
+
+// Whether this build counts heap allocations, which can't change once the module has loaded
+let countingAllocs = null;
+
+/**
+ * Zero the heap allocation counts before a detection, in builds that count them
+ */
+function resetAllocCounts() {
+	if (countingAllocs === null) countingAllocs = Module.ccall("isCountingAllocs", "number", [], []) !== 0;
+	if (countingAllocs) Module.ccall("resetAllocCounts", null, [], []);
+}
+
+/**
+ * Detect objects in an HTML5 canvas into the output buffer
+ * Detection runs in a session that keeps its workspace from frame to frame, and is rebuilt when the canvas size,
+ * step or delta changes. If the output buffer overflows, it is grown to fit and detection runs again
+ * @return {Number} Number of detection records in the output buffer
+ */
+Wasmface.prototype.detectInto = function(ctx, mindepth, pp, othresh, nthresh, step, delta, minsd) {
+	const w = ctx.canvas.width;
+	const h = ctx.canvas.height;
+	const d = this.detector;
+	if (!d || d.w !== w || d.h !== h || d.step !== step || d.delta !== delta) {
+		if (d) releaseDetector(d);
+		const ptr = Module.ccall("createDetector", "number", ["number", "number", "number", "number", "number"], [this.ptr, w, h, step, delta]);
+		this.detector = {ptr: ptr, w: w, h: h, step: step, delta: delta};
+		if (this.tuning) tuneDetector(ptr, this.tuning);
+	}
+	const session = this.detector;
+	if (this.jitEnabled && !(session.jit && session.jit.failed)) {
+		const generation = Module.ccall("getDetectorGeneration", "number", ["number"], [session.ptr]);
+		if (!session.jit || session.jit.generation !== generation) {
+			if (session.jit) session.jit.functions.forEach(fn => Module.removeFunction(fn));
+			compileDetector(session, this.cacheName).catch(err => console.warn(err.message + ", detecting with the interpreter"));
+		}
+	}
+	if (!this.output) this.reserve(64);
+	const inputBuf = this.upload(ctx);
+
+	resetAllocCounts();
+	const start = performance.now();
+	const args = [this.detector.ptr, inputBuf, pp, othresh, nthresh, minsd, mindepth];
+	const found = Module.ccall("detectWith", "number", detectWithTypes, args.concat([this.output.ptr, this.output.capacity]));
+	if (found > this.output.capacity) {
+		this.reserve(found);
+		Module.ccall("detectWith", "number", detectWithTypes, args.concat([this.output.ptr, this.output.capacity]));
+	}
+	this.timing.detect = performance.now() - start;
+
+	return Module.HEAP32[this.output.ptr / Int32Array.BYTES_PER_ELEMENT];
+}
+
+/**
+ * Detect objects in an HTML5 canvas, returning the output buffer itself rather than a copy of it
+ * The view is only valid until the next call that writes to the output buffer
+ * @param  {Canvas context object} ctx      2D context for the canvas 
+ * @param  {Number}                mindepth Minimum number of stages passed to report a subwindow, 0 reports positive detections only
+ * @param  {Number}                pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Number}                othresh  Overlap threshold for post processing
+ * @param  {Number}                nthresh  Neighbor threshold for post processing
+ * @param  {Number}                step     Detector scale step to apply
+ * @param  {Number}                delta    Detector sweep delta to apply
+ * @param  {Number}                minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @return {Int32Array}                     View of the detection records, seven elements [x, y, s, depth, margin, neighbors, label] each, 
+ *                                          where margin is a float
+ */
+Wasmface.prototype.detectView = function(ctx, mindepth = 0, pp = 1, othresh = 0.3, nthresh = 10, step = 2.0, delta = 2.0, minsd = 0) {
+	const count = this.detectInto(ctx, mindepth, pp, othresh, nthresh, step, delta, minsd);
+	const start = this.output.ptr / Int32Array.BYTES_PER_ELEMENT + 2;
+	this.timing.read = 0;
+	return Module.HEAP32.subarray(start, start + count * 7);
+}
+
 /**
  * Detect objects in an HTML5 canvas
  * @param  {Canvas context object} ctx     2D context for the canvas 
- * @param  {Number}                pp      1 for post processing, 0 for no post processing
+ * @param  {Number}                pp      0 for no post processing, 1 for non-maximum suppression, 2 for grouping
  * @param  {Number}                othresh Overlap threshold for post processing
  * @param  {Number}                nthresh Neighbor threshold for post processing
  * @param  {Number}                step    Detector scale step to apply
  * @param  {Number}                delta   Detector sweep delta to apply
+ * @param  {Number}                minsd   Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
  * @return {Array}                         2D array of 1:1 aspect ratio bounding boxes [x, y, s] where s = width and height
  */
-Wasmface.prototype.detect = function(ctx, pp = 1, othresh = 0.3, nthresh = 10, step = 2.0, delta = 2.0) {
-	const inputImgData = ctx.getImageData(0, 0, ctx.canvas.width, ctx.canvas.height);
-	const inputBuf = Module._malloc(inputImgData.data.length);
-	Module.HEAPU8.set(inputImgData.data, inputBuf);
+Wasmface.prototype.detect = function(ctx, pp = 1, othresh = 0.3, nthresh = 10, step = 2.0, delta = 2.0, minsd = 0) {
+	const count = this.detectInto(ctx, 0, pp, othresh, nthresh, step, delta, minsd);
+	const start = performance.now();
+	const boxes = [];
+	for (let i = 0, j = this.output.ptr / Int32Array.BYTES_PER_ELEMENT + 2; i < count; i += 1, j += 7) {
+		boxes.push([Module.HEAP32[j], Module.HEAP32[j + 1], Module.HEAP32[j + 2]]);
+	}
+	this.timing.read = performance.now() - start;
+	return boxes;
+}
 
-	const ptr = Module.ccall("detect", "number", 
-                             ["number", "number", "number", "number", "number", "number", "number", "number", "number"], 
-                             [inputBuf, ctx.canvas.width, ctx.canvas.height, this.ptr, step, delta, pp, othresh, nthresh])
-	                         / Uint16Array.BYTES_PER_ELEMENT;
+/**
+ * Detect objects in an HTML5 canvas and score each detection
+ * @param  {Canvas context object} ctx      2D context for the canvas 
+ * @param  {Number}                mindepth Minimum number of stages passed to report a subwindow, 0 reports positive detections only
+ * @param  {Number}                pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Number}                othresh  Overlap threshold for post processing
+ * @param  {Number}                nthresh  Neighbor threshold for post processing
+ * @param  {Number}                step     Detector scale step to apply
+ * @param  {Number}                delta    Detector sweep delta to apply
+ * @param  {Number}                minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @return {Array}                          Array of detections {x, y, s, depth, margin, neighbors, label} where s = width and height
+ */
+Wasmface.prototype.detectScored = function(ctx, mindepth = 0, pp = 1, othresh = 0.3, nthresh = 10, step = 2.0, delta = 2.0, minsd = 0) {
+	const count = this.detectInto(ctx, mindepth, pp, othresh, nthresh, step, delta, minsd);
+	const start = performance.now();
+	const detections = readDetections(this.output.ptr / Int32Array.BYTES_PER_ELEMENT + 2, count);
+	this.timing.read = performance.now() - start;
+	return detections;
+}
 
-	const len = Module.HEAPU16[ptr];
-	const boxes = [];
-	for (let i = 1; i < len; i += 3) {
-		const box = [Module.HEAPU16[ptr + i], Module.HEAPU16[ptr + i + 1], Module.HEAPU16[ptr + i + 2]];
-		boxes.push(box);
+/**
+ * Detect objects with several models in an HTML5 canvas in one pass
+ * The canvas is converted to grayscale and integrated once for every model, and models whose subwindows are the
+ * same size share their subwindow statistics. Detections are labeled by the index of their model in models
+ * @param  {Canvas context object} ctx      2D context for the canvas 
+ * @param  {Array}                 models   Array of Wasmface objects to detect with, which may include this one
+ * @param  {Number}                pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Number}                othresh  Overlap threshold for post processing
+ * @param  {Number}                nthresh  Neighbor threshold for post processing
+ * @param  {Number}                step     Detector scale step to apply
+ * @param  {Number}                delta    Detector sweep delta to apply
+ * @param  {Number}                minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @param  {Number}                mindepth Minimum number of stages passed to report a subwindow, 0 reports positive detections only
+ * @return {Array}                          Array of detections {x, y, s, depth, margin, neighbors, label} where s = width and height
+ */
+Wasmface.prototype.detectMulti = function(ctx, models, pp = 1, othresh = 0.3, nthresh = 10, step = 2.0, delta = 2.0, minsd = 0, mindepth = 0) {
+	const w = ctx.canvas.width;
+	const h = ctx.canvas.height;
+	const ptrs = models.map(model => model.ptr);
+	const m = this.multi;
+	if (!m || m.w !== w || m.h !== h || m.step !== step || m.delta !== delta || m.ptrs.join() !== ptrs.join()) {
+		if (m) Module.ccall("destroyMultiDetector", null, ["number"], [m.ptr]);
+		const list = Module._malloc(ptrs.length * Int32Array.BYTES_PER_ELEMENT);
+		Module.HEAP32.set(ptrs, list / Int32Array.BYTES_PER_ELEMENT);
+		const ptr = Module.ccall("createMultiDetector", "number", ["number", "number", "number", "number", "number", "number"], 
+		                         [list, ptrs.length, w, h, step, delta]);
+		Module._free(list);
+		this.multi = {ptr: ptr, ptrs: ptrs, w: w, h: h, step: step, delta: delta};
+	}
+	if (!this.output) this.reserve(64);
+	const inputBuf = this.upload(ctx);
+
+	resetAllocCounts();
+	let start = performance.now();
+	const args = [this.multi.ptr, inputBuf, pp, othresh, nthresh, minsd, mindepth];
+	const found = Module.ccall("detectMulti", "number", detectWithTypes, args.concat([this.output.ptr, this.output.capacity]));
+	if (found > this.output.capacity) {
+		this.reserve(found);
+		Module.ccall("detectMulti", "number", detectWithTypes, args.concat([this.output.ptr, this.output.capacity]));
 	}
+	this.timing.detect = performance.now() - start;
 
-	Module._free(inputBuf);
-	Module._free(ptr);
+	start = performance.now();
+	const count = Module.HEAP32[this.output.ptr / Int32Array.BYTES_PER_ELEMENT];
+	const detections = readDetections(this.output.ptr / Int32Array.BYTES_PER_ELEMENT + 2, count);
+	this.timing.read = performance.now() - start;
+	return detections;
+}
+
+/**
+ * Detect objects in many images with one call into wasm
+ * Images may differ in size. The pixels and a descriptor for each image are copied into one heap buffer and the
+ * results come back as one table, so a batch of thumbnails pays the call overhead once rather than per image. The
+ * batch session, its input buffer and its output buffer are kept from call to call and grow as needed
+ * @param  {Array}  images   Array of HTML5 ImageData objects
+ * @param  {Number} pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Number} othresh  Overlap threshold for post processing
+ * @param  {Number} nthresh  Neighbor threshold for post processing
+ * @param  {Number} step     Detector scale step to apply
+ * @param  {Number} delta    Detector sweep delta to apply
+ * @param  {Number} minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @param  {Number} mindepth Minimum number of stages passed to report a subwindow (0 reports positive detections only)
+ * @param  {Number} threads  Number of worker threads, used only by builds with -pthread
+ * @return {Array}           For each image, an array of detections as returned by detectScored
+ */
+Wasmface.prototype.detectBatch = function(images, pp = 1, othresh = 0.3, nthresh = 10, step = 2.0, delta = 2.0, minsd = 0, mindepth = 0, threads = 1) {
+	const b = this.batch;
+	if (!b || b.step !== step || b.delta !== delta || b.threads !== threads) {
+		if (b) Module.ccall("destroyBatchDetector", null, ["number"], [b.ptr]);
+		const ptr = Module.ccall("createBatchDetector", "number", ["number", "number", "number", "number"], [this.ptr, step, delta, threads]);
+		this.batch = {ptr: ptr, step: step, delta: delta, threads: threads, input: b ? b.input : 0, size: b ? b.size : 0, 
+		              output: b ? b.output : 0, capacity: b ? b.capacity : -1, count: b ? b.count : 0};
+	}
+	const batch = this.batch;
+
+	// Descriptors [ptr, w, h] come first, then the pixels of each image
+	let start = performance.now();
+	const headerSize = images.length * 3 * Int32Array.BYTES_PER_ELEMENT;
+	const size = images.reduce((total, image) => total + image.data.length, headerSize);
+	if (batch.size < size) {
+		Module._free(batch.input);
+		batch.input = Module._malloc(size);
+		batch.size = size;
+	}
+	for (let i = 0, offset = batch.input + headerSize; i < images.length; i += 1) {
+		Module.HEAP32.set([offset, images[i].width, images[i].height], batch.input / Int32Array.BYTES_PER_ELEMENT + i * 3);
+		Module.HEAPU8.set(images[i].data, offset);
+		offset += images[i].data.length;
+	}
+	this.timing.upload = performance.now() - start;
+
+	const reserve = (capacity) => {
+		Module._free(batch.output);
+		batch.output = Module._malloc((3 + images.length + capacity * 7) * Int32Array.BYTES_PER_ELEMENT);
+		batch.capacity = capacity;
+		batch.count = images.length;
+	};
+	if (batch.capacity < 0 || batch.count < images.length) reserve(Math.max(64, batch.capacity));
+
+	resetAllocCounts();
+	start = performance.now();
+	const types = detectWithTypes.concat(["number"]);
+	const args = [batch.ptr, batch.input, images.length, pp, othresh, nthresh, minsd, mindepth];
+	const found = Module.ccall("detectBatch", "number", types, args.concat([batch.output, batch.capacity]));
+	if (found > batch.capacity) {
+		reserve(found);
+		Module.ccall("detectBatch", "number", types, args.concat([batch.output, batch.capacity]));
+	}
+	this.timing.detect = performance.now() - start;
+
+	start = performance.now();
+	const offsets = batch.output / Int32Array.BYTES_PER_ELEMENT + 2;
+	const records = offsets + images.length + 1;
+	const results = [];
+	for (let i = 0; i < images.length; i += 1) {
+		const first = Module.HEAP32[offsets + i];
+		results.push(readDetections(records + first * 7, Module.HEAP32[offsets + i + 1] - first));
+	}
+	this.timing.read = performance.now() - start;
+	return results;
+}
+
+/**
+ * Detect objects in an HTML5 canvas within a time budget
+ * Regions around the previous call's detections are searched first, then the full scan resumes where the
+ * previous call stopped, so consecutive video frames share the work of covering every scale
+ * @param  {Canvas context object} ctx     2D context for the canvas 
+ * @param  {Number}                budget  Time budget in milliseconds
+ * @param  {Number}                pp      0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Number}                othresh Overlap threshold for post processing
+ * @param  {Number}                nthresh Neighbor threshold for post processing
+ * @param  {Number}                step    Detector scale step to apply
+ * @param  {Number}                delta   Detector sweep delta to apply
+ * @param  {Number}                minsd   Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @return {Array}                         2D array of 1:1 aspect ratio bounding boxes [x, y, s] where s = width and height
+ */
+Wasmface.prototype.detectAnytime = function(ctx, budget = 16, pp = 1, othresh = 0.3, nthresh = 10, step = 2.0, delta = 2.0, minsd = 0) {
+	const w = ctx.canvas.width;
+	const h = ctx.canvas.height;
+	const a = this.anytime;
+	if (!a || a.w !== w || a.h !== h || a.step !== step || a.delta !== delta) {
+		if (a) Module.ccall("destroyAnytime", null, ["number"], [a.ptr]);
+		const ptr = Module.ccall("createAnytime", "number", ["number", "number", "number", "number", "number"], [this.ptr, w, h, step, delta]);
+		this.anytime = {ptr: ptr, w: w, h: h, step: step, delta: delta};
+	}
+
+	const inputBuf = this.upload(ctx);
+
+	if (!this.output) this.reserve(64);
+
+	let start = performance.now();
+	const found = Module.ccall("detectAnytime", "number", 
+	                           ["number", "number", "number", "number", "number", "number", "number", "number", "number"], 
+	                           [this.anytime.ptr, inputBuf, budget, pp, othresh, nthresh, minsd, this.output.ptr, this.output.capacity]);
+	if (found > this.output.capacity) {
+		this.reserve(found);
+		Module.ccall("readAnytime", "number", ["number", "number", "number"], [this.anytime.ptr, this.output.ptr, this.output.capacity]);
+	}
+	this.timing.detect = performance.now() - start;
+
+	start = performance.now();
+	const i = this.output.ptr / Int32Array.BYTES_PER_ELEMENT;
+	const count = Module.HEAP32[i];
+	const boxes = [];
+	for (let j = i + 2; j < i + 2 + count * 3; j += 3) {
+		boxes.push([Module.HEAP32[j], Module.HEAP32[j + 1], Module.HEAP32[j + 2]]);
+	}
+	this.timing.read = performance.now() - start;
 
 	return boxes;
+}
+
+/**
+ * Get the coverage report from the most recent call to detectAnytime
+ * @return {Object} Subwindows swept by the full scan and around previous detections, total subwindows in a full scan,
+ *                  scales completed, where the next call will resume, full scans completed and elapsed milliseconds
+ */
+Wasmface.prototype.coverage = function() {
+	if (!this.anytime) return null;
+	const i = Module.ccall("getCoverage", "number", ["number"], [this.anytime.ptr]) / Int32Array.BYTES_PER_ELEMENT;
+	return {
+		windows: Module.HEAP32[i],
+		totalWindows: Module.HEAP32[i + 1],
+		roiWindows: Module.HEAP32[i + 2],
+		scalesCompleted: Module.HEAP32[i + 3],
+		scale: Module.HEAP32[i + 4],
+		row: Module.HEAP32[i + 5],
+		cycles: Module.HEAP32[i + 6],
+		elapsed: Module.HEAPF32[i + 7]
+	};
+}
+
+/**
+ * Detect and track objects in the next frame of a video stream drawn to an HTML5 canvas
+ * The whole canvas is scanned every interval frames. In between, only the neighborhoods of existing tracks
+ * are scanned, so most frames cost a fraction of a call to detect
+ * @param  {Canvas context object} ctx      2D context for the canvas 
+ * @param  {Number}                interval Number of frames between full scans
+ * @param  {Number}                pp       0 for no post processing, 1 for non-maximum suppression, 2 for grouping
+ * @param  {Number}                othresh  Overlap threshold for post processing
+ * @param  {Number}                nthresh  Neighbor threshold for post processing
+ * @param  {Number}                step     Detector scale step to apply
+ * @param  {Number}                delta    Detector sweep delta to apply
+ * @param  {Number}                minsd    Minimum subwindow standard deviation, flatter subwindows are rejected (0 disables)
+ * @return {Array}                          2D array of tracks [x, y, s, id] where s = width and height and id persists across frames
+ */
+Wasmface.prototype.track = function(ctx, interval = 10, pp = 1, othresh = 0.3, nthresh = 10, step = 2.0, delta = 2.0, minsd = 0) {
+	const w = ctx.canvas.width;
+	const h = ctx.canvas.height;
+	const t = this.tracker;
+	if (!t || t.w !== w || t.h !== h || t.step !== step || t.delta !== delta || t.interval !== interval) {
+		if (t) Module.ccall("destroyTracker", null, ["number"], [t.ptr]);
+		const ptr = Module.ccall("createTracker", "number", ["number", "number", "number", "number", "number", "number"], 
+		                         [this.ptr, w, h, step, delta, interval]);
+		this.tracker = {ptr: ptr, w: w, h: h, step: step, delta: delta, interval: interval};
+		if (this.gate) Module.ccall("setMotionGate", null, ["number", "number", "number", "number"], 
+		                            [ptr, this.gate.blockSize, this.gate.thresh, this.gate.refresh]);
+	}
+
+	const inputBuf = this.upload(ctx);
+
+	if (!this.output) this.reserve(64);
+
+	// Track records are shorter than detection records, so the detection output buffer holds as many of them
+	let start = performance.now();
+	const found = Module.ccall("track", "number", 
+	                           ["number", "number", "number", "number", "number", "number", "number", "number"], 
+	                           [this.tracker.ptr, inputBuf, pp, othresh, nthresh, minsd, this.output.ptr, this.output.capacity]);
+	if (found > this.output.capacity) {
+		this.reserve(found);
+		Module.ccall("readTracks", "number", ["number", "number", "number"], [this.tracker.ptr, this.output.ptr, this.output.capacity]);
+	}
+	this.timing.detect = performance.now() - start;
+
+	start = performance.now();
+	const i = this.output.ptr / Int32Array.BYTES_PER_ELEMENT;
+	const count = Module.HEAP32[i];
+	const tracks = [];
+	for (let j = i + 2; j < i + 2 + count * 4; j += 4) {
+		tracks.push([Module.HEAP32[j], Module.HEAP32[j + 1], Module.HEAP32[j + 2], Module.HEAP32[j + 3]]);
+	}
+	this.timing.read = performance.now() - start;
+
+	return tracks;
+}
+
+/**
+ * Gate the full scans made by track on motion, for static cameras
+ * Scheduled full scans then only sweep the blocks that moved since the last scan plus tracked regions
+ * @param {Number} blockSize Width and height of the blocks that motion is measured over (0 disables gating)
+ * @param {Number} thresh    Minimum change in a block's mean or standard deviation luma that counts as motion
+ * @param {Number} refresh   Number of frames between true full scans
+ */
+Wasmface.prototype.setMotionGate = function(blockSize = 32, thresh = 4, refresh = 60) {
+	this.gate = blockSize > 0 ? {blockSize: blockSize, thresh: thresh, refresh: refresh} : null;
+	if (this.tracker) Module.ccall("setMotionGate", null, ["number", "number", "number", "number"], 
+	                               [this.tracker.ptr, blockSize, thresh, refresh]);
+}
+
+/**
+ * Get the number of blocks that moved in the most recent frame passed to track
+ * @return {Number} Moved block count
+ */
+Wasmface.prototype.movedBlocks = function() {
+	if (!this.tracker) return 0;
+	return Module.ccall("getMovedBlocks", "number", ["number"], [this.tracker.ptr]);
+}
+
+/**
+ * Get the heap allocations made by each phase of the most recent detection
+ * Allocations are only counted by builds compiled with WASMFACE_COUNT_ALLOCS defined
+ * @return {Object} Allocation count and bytes for each phase, or null if allocations are not counted
+ */
+Wasmface.prototype.allocs = function() {
+	if (!Module.ccall("isCountingAllocs", "number", [], [])) return null;
+	const phases = ["other", "grayscale", "integral", "sweep", "postprocess", "output"];
+	const allocs = {};
+	for (let i = 0; i < phases.length; i += 1) {
+		allocs[phases[i]] = {
+			count: Module.ccall("getAllocCount", "number", ["number"], [i]),
+			bytes: Module.ccall("getAllocBytes", "number", ["number"], [i])
+		};
+	}
+	return allocs;
+}
+
+/**
+ * Get subwindow counts from the most recent detection
+ * @return {Object} Number of subwindows considered and number rejected by the variance floor
+ */
+Wasmface.prototype.stats = function() {
+	return {
+		windows: Module.ccall("getWindowCount", "number", [], []),
+		rejected: Module.ccall("getRejectedCount", "number", [], [])
+	};
 }
\ No newline at end of file